@@ -2,7 +2,13 @@
 #define BLIZZARDARCHIVE_BASEARCHIVE_HPP
 
 #include <ClientData.hpp>
+#include <Manifest.hpp>
+#include <SharedBuffer.hpp>
 #include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
 
 namespace BlizzardArchive::Listfile
 {
@@ -15,7 +21,7 @@ namespace BlizzardArchive::Archive
   class BaseArchive
   {
   public:
-    BaseArchive(std::string const& path, Locale locale, Listfile::Listfile* listfile);
+    BaseArchive(std::string const& path, Locale locale, Listfile::Listfile const* listfile);
     virtual ~BaseArchive() = default;
 
     [[nodiscard]]
@@ -33,10 +39,75 @@ namespace BlizzardArchive::Archive
     [[nodiscard]]
     virtual bool exists(Listfile::FileKey const& file_key, Locale locale) const = 0;
 
+    /*
+    * Opens, reads and closes a file in one call. Unlike the handle based methods above,
+    * this and exists() are safe to call from multiple threads at the same time.
+    * Returns false if the file is not in this archive or could not be read.
+    */
+    [[nodiscard]]
+    virtual bool readFile(Listfile::FileKey const& file_key, Locale locale, std::vector<char>& buffer) const = 0;
+
+    // Same as readFile, for archives that can hand out their contents without copying them. Empty if not found.
+    [[nodiscard]]
+    virtual SharedBuffer readFileShared(Listfile::FileKey const& file_key, Locale locale) const
+    {
+      std::vector<char> buffer;
+      return readFile(file_key, locale, buffer) ? SharedBuffer(std::move(buffer)) : SharedBuffer();
+    }
+
+    /*
+    * Position of the file's data within the archive storage, used to order batched reads so that they
+    * hit the disk sequentially. Returns std::nullopt if the file is not in this archive.
+    * Archives without a meaningful data layout report every present file at offset 0.
+    */
+    [[nodiscard]]
+    virtual std::optional<std::uint64_t> getFileOffset(Listfile::FileKey const& file_key, Locale locale) const
+    {
+      return exists(file_key, locale) ? std::optional<std::uint64_t>(0) : std::nullopt;
+    }
+
+    // MD5 of the decoded file contents, for archives whose index records it. Empty otherwise or if not found.
+    [[nodiscard]]
+    virtual std::optional<ContentKey> getContentKey(Listfile::FileKey const&, Locale) const
+    {
+      return std::nullopt;
+    }
+
+    struct FileLocation
+    {
+      std::uint64_t offset = 0;
+      std::optional<ContentKey> content_key;
+    };
+
+    // getFileOffset and getContentKey at once, for archives answering both from the same lookup.
+    [[nodiscard]]
+    virtual std::optional<FileLocation> locateFile(Listfile::FileKey const& file_key, Locale locale) const
+    {
+      std::optional<std::uint64_t> const offset = getFileOffset(file_key, locale);
+
+      if (!offset)
+        return std::nullopt;
+
+      return FileLocation{ offset.value(), getContentKey(file_key, locale) };
+    }
+
+    /*
+    * Calls callback with the normalized internal path of every file stored in the archive.
+    * Returns false if the archive can not enumerate its contents completely, in which case
+    * lookups have to fall back to probing it directly.
+    */
+    virtual bool forEachFile(std::function<void(std::string const&)> const&) const { return false; }
+
+    /*
+    * Calls callback with the size and recorded content hash of every file, without reading any of them.
+    * Returns false if the archive can not be enumerated or does not know what its files contain.
+    */
+    virtual bool forEachManifestEntry(std::function<void(ManifestEntry&&)> const&) const { return false; }
+
   protected:
     std::string _path;
     Locale _locale;
-    Listfile::Listfile* _listfile;
+    Listfile::Listfile const* _listfile;
   };
 }
 
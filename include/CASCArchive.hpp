@@ -2,6 +2,10 @@
 #define BLIZZARDARCHIVE_CASCARCHIVE_HPP
 
 #include <BaseArchive.hpp>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
 
 namespace BlizzardArchive::Listfile
 {
@@ -14,7 +18,12 @@ namespace BlizzardArchive::Archive
   class CASCArchive : public BaseArchive
   {
   public:
-    CASCArchive(std::string const& path, std::string const& cache_path, Locale locale, OpenMode open_mode, Listfile::Listfile* listfile);
+    /*
+    * file_index_directory - where to keep the set of file data IDs present in the storage between runs,
+    *   nothing is persisted if empty.
+    */
+    CASCArchive(std::string const& path, std::string const& cache_path, Locale locale, OpenMode open_mode
+      , Listfile::Listfile const* listfile, std::string const& file_index_directory = "");
     ~CASCArchive() override;
 
     [[nodiscard]]
@@ -29,8 +38,60 @@ namespace BlizzardArchive::Archive
     [[nodiscard]]
     bool exists(Listfile::FileKey const& file_key, Locale locale) const override;
 
+    [[nodiscard]]
+    bool readFile(Listfile::FileKey const& file_key, Locale locale, std::vector<char>& buffer) const override;
+
+    [[nodiscard]]
+    std::optional<std::uint64_t> getFileOffset(Listfile::FileKey const& file_key, Locale locale) const override;
+
+    // Content keys and sizes from the root manifest, for the file data IDs of the locale mask.
+    bool forEachManifestEntry(std::function<void(ManifestEntry&&)> const& callback) const override;
+
+    [[nodiscard]]
+    std::optional<ContentKey> getContentKey(Listfile::FileKey const& file_key, Locale locale) const override;
+
+    // Offset and content key from a single lookup of the file's storage record.
+    [[nodiscard]]
+    std::optional<FileLocation> locateFile(Listfile::FileKey const& file_key, Locale locale) const override;
+
+    // Key of the stored, encoded data. Files with the same content key usually share it too.
+    [[nodiscard]]
+    std::optional<ContentKey> getEncodingKey(Listfile::FileKey const& file_key, Locale locale) const;
+
+    /*
+    * Reads every distinct blob behind the file data IDs once, which makes remote storages download
+    * them into their cache. See ClientData::prefetch.
+    */
+    PrefetchProgress prefetch(std::span<std::uint32_t const> file_data_ids
+      , PrefetchCallback const& callback
+      , unsigned concurrency) const;
+
   private:
+    [[nodiscard]]
+    std::uint32_t getFileDataID(Listfile::FileKey const& file_key) const;
+
+    /*
+    * Fills _file_data_ids with every file data ID of the root manifest available for the locale mask,
+    * from the persisted copy when it matches the build. Leaves it empty if the storage can not be enumerated.
+    */
+    void buildFileDataIDIndex(std::string const& file_index_directory);
+
+    [[nodiscard]]
+    bool loadFileDataIDIndex(std::string const& index_path, std::uint32_t build_number);
+    void saveFileDataIDIndex(std::string const& index_path, std::uint32_t build_number) const;
+
+    [[nodiscard]]
+    bool hasFileDataID(std::uint32_t file_data_id) const
+    {
+      return (file_data_id >> 6) < _file_data_ids.size() && (_file_data_ids[file_data_id >> 6] >> (file_data_id & 63)) & 1;
+    }
+
+    // CascLib storage handles can be shared between threads as long as every thread uses its own file handles.
     HANDLE _handle = nullptr;
+    std::uint32_t _locale_mask = 0;
+
+    // Bitmap of the file data IDs in the root manifest, answers exists() without going through CascLib.
+    std::vector<std::uint64_t> _file_data_ids;
   };
 
 }
@@ -2,13 +2,21 @@
 #define BLIZZARD_ARCHIVE_CLIENT_DATA_HPP
 
 #include <array>
+#include <cstdint>
+#include <functional>
 #include <vector>
 #include <string>
 #include <optional>
-#include <mutex>
+#include <span>
 #include <string_view>
+#include <unordered_map>
+#include <unordered_set>
 
 #include <Listfile.hpp>
+#include <FileCache.hpp>
+#include <Manifest.hpp>
+#include <SharedBuffer.hpp>
+#include <memory>
 
 typedef void* HANDLE;
 
@@ -20,6 +28,11 @@ namespace BlizzardArchive
     class BaseArchive;
   }
 
+  namespace Listfile
+  {
+    class PathIndex;
+  }
+
 
   enum class ClientVersion : char
   {
@@ -62,6 +75,21 @@ namespace BlizzardArchive
     ruRU
   };
 
+  // MD5 of the decoded contents of a CASC file. Files with the same content key are byte-identical.
+  using ContentKey = std::array<std::uint8_t, 16>;
+
+  // Counts of distinct storage blobs, files sharing their encoded data are fetched once.
+  struct PrefetchProgress
+  {
+    std::size_t total = 0;
+    std::size_t completed = 0;
+    std::size_t failed = 0;
+    std::uint64_t bytes = 0;
+  };
+
+  // Called after every blob, from the prefetching threads but never from two at once.
+  using PrefetchCallback = std::function<void(PrefetchProgress const&)>;
+
   class ClientData
   {
   public:
@@ -71,17 +99,28 @@ namespace BlizzardArchive
     * version - version of the game client. Currently only WotLK and Shadowlands are supported.
     * locale - prefered locale of the client. Wotlk supports automatic detection, for that use Locale::AUTO
     * local_path - project directory, should also contain listfile.csv for CASC-based projects.
+    * listfile - listfile to use instead of loading one, CASC clients only. By default they share the listfile.csv of
+    *   local_path with other clients through Listfile::ListfileRegistry, pass ListfileRegistry::acquire(local_path, true)
+    *   to map a compiled listfile.bin instead. MPQ clients merge the (listfile)s of their archives into one of
+    *   their own, passing one throws std::invalid_argument.
+    * persist_file_data_id_index - CASC only, keeps the set of file data IDs in the storage between runs so
+    *   opening it again skips enumerating the root manifest. Stored next to the storage (in the CDN cache
+    *   directory for online storages), which has to be writable.
     */
     explicit ClientData(std::string const& path
       , ClientVersion version
       , Locale locale
-      , std::string const& local_path);
+      , std::string const& local_path
+      , std::shared_ptr<Listfile::Listfile const> listfile = nullptr
+      , bool persist_file_data_id_index = false);
 
     explicit ClientData(std::string const& path
         , std::string const& cdn_cache_path
         , ClientVersion version
         , Locale locale
-        , std::string const& local_path);
+        , std::string const& local_path
+        , std::shared_ptr<Listfile::Listfile const> listfile = nullptr
+        , bool persist_file_data_id_index = false);
 
     ~ClientData();
 
@@ -100,20 +139,96 @@ namespace BlizzardArchive
     std::string const& localPath() const { return _local_path; }
 
     [[nodiscard]]
-    std::string getDiskPath(Listfile::FileKey const& file_key);
+    std::string getDiskPath(Listfile::FileKey const& file_key) const;
+
+    // Disk path of a file data ID the listfile has no name for.
+    [[nodiscard]]
+    std::string getUnknownFileDiskPath(std::uint32_t file_data_id) const;
+
+    const Listfile::Listfile* listfile() const { return _listfile.get(); }
+
+    // For handing the listfile on to other clients.
+    [[nodiscard]]
+    std::shared_ptr<Listfile::Listfile const> const& sharedListfile() const { return _listfile; }
+
+    /* Methods used to universally request client file data in an archive type agnostic way.
+    *  They do not take any lock and are safe to call from any number of threads at once.
+    */
+
+    [[nodiscard]]
+    bool readFile(Listfile::FileKey const& file_key, std::vector<char>& buffer) const;
+
+    // Returns the file contents, shared with the cache when it is enabled. Empty if the file was not found.
+    [[nodiscard]]
+    SharedBuffer readFileShared(Listfile::FileKey const& file_key) const;
+
+    /*
+    * Reads many files at once. The files are resolved together, grouped per archive, ordered by their
+    * position in the archive storage and read by up to worker_count threads: the calling one and workers
+    * of the shared IOExecutor (all of them if 0). Called from an IOExecutor worker, it reads inline.
+    * Files sharing a content key are read once.
+    * Results are in the order of file_keys, empty for files that could not be found or read.
+    */
+    [[nodiscard]]
+    std::vector<std::optional<std::vector<char>>> readFiles(std::span<Listfile::FileKey const> file_keys
+      , unsigned worker_count = 0) const;
+
+    /*
+    * Downloads the files of a remote CASC storage into the CDN cache ahead of reading them, with at most
+    * concurrency fetches in flight. Files are deduplicated by encoding key first. Unknown files count as failed.
+    * Nothing to do for local storages, every file is already on disk.
+    */
+    PrefetchProgress prefetch(std::span<Listfile::FileKey const> file_keys
+      , PrefetchCallback const& callback = nullptr
+      , unsigned concurrency = 8) const;
+
+    // Same, for every file of the index under any of the path prefixes.
+    PrefetchProgress prefetch(Listfile::PathIndex const& index
+      , std::span<std::string_view const> prefixes
+      , PrefetchCallback const& callback = nullptr
+      , unsigned concurrency = 8) const;
+
+    [[nodiscard]]
+    bool exists(Listfile::FileKey const& file_key) const;
 
-    const Listfile::Listfile* listfile() const { return &_listfile; }
+    /*
+    * Size and recorded content hash of every file, merged in override order. Reads no file data.
+    * Archives that can not enumerate their contents (patched MPQs, directories) are left out.
+    */
+    [[nodiscard]]
+    Manifest exportManifest() const;
 
-    /* Methods used to universally request client file data in an archive type agnostic way. */
+    /*
+    * Reads the files through readFiles and writes them to their disk paths under local_path, batch_size
+    * files at a time. Returns the number of files written. Pair with Manifest::diff to extract only what changed.
+    */
+    std::size_t extractFiles(std::span<Listfile::FileKey const> file_keys
+      , unsigned worker_count = 0
+      , std::size_t batch_size = 256) const;
 
+    // Looked up in the storage on every call. Empty for unknown files and on storages without content keys.
     [[nodiscard]]
-    bool readFile(Listfile::FileKey const& file_key, std::vector<char>& buffer);
+    std::optional<ContentKey> getContentKey(Listfile::FileKey const& file_key) const;
 
     [[nodiscard]]
-    bool exists(Listfile::FileKey const& file_key);
+    bool existsOnDisk(Listfile::FileKey const& file_key) const;
+
+    /*
+    * Enables caching of file contents read through readFile and readFileShared, up to byte_budget bytes.
+    * 0 disables the cache. Loose files are copied into it, never cached as mappings.
+    * Must not be called while other threads are reading.
+    */
+    void setCacheBudget(std::size_t byte_budget);
+
+    /*
+    * Picks up loose files added to or removed from the directory archives since they were opened or last
+    * refreshed, and empties the cache as what overrides what may have changed. Safe to call while other threads read.
+    */
+    void refreshDirectories();
 
+    // Hit, miss and eviction counters of the cache. All zero when the cache is disabled.
     [[nodiscard]]
-    bool existsOnDisk(Listfile::FileKey const& file_key);
+    FileCacheStats cacheStats() const;
 
     /* Static helper methods */
     [[nodiscard]]
@@ -184,8 +299,30 @@ namespace BlizzardArchive
 
     void initializeMPQStorage();
     void loadMPQArchive(std::string const& mpq_path);
+    // Returns nullptr if there is nothing to load at mpq_path. Safe to call concurrently.
+    [[nodiscard]]
+    Archive::BaseArchive* openArchive(std::string const& mpq_path);
+    // Names of the entries in Data/ and Data/<locale>/, the latter prefixed with "<locale>/".
+    [[nodiscard]]
+    std::unordered_map<std::string, std::string> scanDataDirectory() const;
+    // Archive names matching the template that are present in the scanned entries, in load order.
+    [[nodiscard]]
+    std::vector<std::string> expandArchiveTemplate(std::string_view name_template
+      , std::unordered_map<std::string, std::string> const& data_entries) const;
     void initializeCASCStorage();
     void validateLocale();
+    void buildFileIndex();
+
+    // File data ID when known and the normalized path otherwise, so both kinds of keys share cache entries on CASC.
+    [[nodiscard]]
+    std::string cacheKey(Listfile::FileKey const& file_key) const;
+
+    [[nodiscard]]
+    bool readFileUncached(Listfile::FileKey const& file_key, std::vector<char>& buffer) const;
+
+    // Calls visitor on every archive that may contain the file, most up-to-date first, until it returns true.
+    template<typename Visitor>
+    bool visitCandidateArchives(Listfile::FileKey const& file_key, Visitor&& visitor) const;
       
     void initializeMPQStoragePreCata();
     void initializeMPQStoragePostCata();
@@ -197,14 +334,21 @@ namespace BlizzardArchive
     std::string _path;
     std::string _local_path;
     std::optional<std::string> _cdn_cache_path;
+    bool _persist_file_data_id_index = false;
 
     // A sorted list of loaded archives. The last one is the most up-to-date one.
+    // Never modified after construction, which is what makes concurrent reads lock-free.
     std::vector<Archive::BaseArchive*> _archives;
-    Listfile::Listfile _listfile;
+    std::shared_ptr<Listfile::Listfile const> _listfile;
+    // The listfile of MPQ clients, owned by _listfile. Archives merge their (listfile) into it as they open.
+    Listfile::Listfile* _mpq_listfile = nullptr;
 
-    // sync
-    std::mutex _mutex;
+    // Maps the interned path of every file of the enumerable archives to the index of the archive winning the override order.
+    tsl::robin_map<std::uint32_t, std::size_t> _file_index;
+    // Indices of the archives missing from _file_index, which have to be probed directly.
+    std::vector<std::size_t> _unindexed_archives;
 
+    std::unique_ptr<FileCache> _cache;
 
   };
 }
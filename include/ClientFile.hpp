@@ -3,7 +3,14 @@
 
 #include <ClientData.hpp>
 #include <BaseArchive.hpp>
+#include <IOExecutor.hpp>
+#include <SharedBuffer.hpp>
+#include <coroutine>
+#include <exception>
 #include <filesystem>
+#include <future>
+#include <memory>
+#include <stop_token>
 
 namespace BlizzardArchive
 {
@@ -20,9 +27,34 @@ namespace BlizzardArchive
     struct NEW_FILE_T {};
     inline static constexpr NEW_FILE_T NEW_FILE {};
 
+    /*
+    * Keys with only a file data ID do not wait for a listfile loading in the background. Until the
+    * listfile is loaded such a file is matched against its unknown_files/ override only, not one saved
+    * under its name. On CASC, keys with a path wait for the listfile to find their file data ID.
+    */
     explicit ClientFile(Listfile::FileKey const& file_key, ClientData* client_data);
     explicit ClientFile(Listfile::FileKey const& file_key, ClientData* client_data, NEW_FILE_T);
 
+    class LoadAwaitable;
+
+    /*
+    * Asynchronous loading. The file is constructed on a worker of executor, exactly like the blocking
+    * constructor would, and its exceptions are forwarded to the caller. Requests that are still queued
+    * when stop_token is triggered fail with Exceptions::OperationCancelledError.
+    */
+    [[nodiscard]]
+    static std::future<std::unique_ptr<ClientFile>> loadAsync(Listfile::FileKey const& file_key
+      , ClientData* client_data
+      , std::stop_token stop_token = {}
+      , IOExecutor* executor = IOExecutor::instance());
+
+    // Coroutine flavour of loadAsync: co_await ClientFile::load(...). The coroutine resumes on the executor.
+    [[nodiscard]]
+    static LoadAwaitable load(Listfile::FileKey const& file_key
+      , ClientData* client_data
+      , std::stop_token stop_token = {}
+      , IOExecutor* executor = IOExecutor::instance());
+
     ClientFile() = delete;
     ClientFile(ClientFile const&) = delete;
     ClientFile(ClientFile&&) = delete;
@@ -59,23 +91,80 @@ namespace BlizzardArchive
     template<typename T>
     const T* get(size_t offset) const
     {
-      return reinterpret_cast<T const*>(_buffer.data() + offset);
+      return reinterpret_cast<T const*>(data() + offset);
     }
 
-    void setBuffer(std::vector<char> const& vec) { _buffer = vec; }
+    /*
+    * Loaded contents are shared with the cache and other readers of the same file.
+    * They are only copied into a private buffer on the first modification.
+    */
+    void setBuffer(std::vector<char> const& vec);
+    void setBuffer(std::vector<char>&& vec);
+    void setBuffer(SharedBuffer const& buffer);
+
+    // Writes at the current position, growing the file as needed.
+    void write(void const* src, std::size_t bytes);
+
+    // Private, modifiable contents. Copies the shared contents on first use.
+    [[nodiscard]]
+    std::vector<char>& getWritableBuffer();
+
+    // True while the file still references shared contents.
+    [[nodiscard]]
+    bool isShared() const { return !_private; }
 
     void save();
 
   private:
+    // Completes the key and sets _disk_path. Returns false instead of waiting for a listfile that is still loading.
+    bool resolveDiskPath(bool wait_for_listfile);
+
+    [[nodiscard]]
+    char const* data() const { return _private ? _buffer.data() : _shared_buffer.data(); }
+
+    [[nodiscard]]
+    std::size_t size() const { return _private ? _buffer.size() : _shared_buffer.size(); }
+
     bool _eof;
+    SharedBuffer _shared_buffer;
     std::vector<char> _buffer;
+    bool _private = false;
     size_t _pointer;
     bool _external;
-    std::filesystem ::path _disk_path;
+    std::filesystem ::path _disk_path; // empty until the listfile names a file data ID key
     Listfile::FileKey _file_key;
+    ClientData* _client_data;
     
 
   };
+
+  class ClientFile::LoadAwaitable
+  {
+  public:
+    LoadAwaitable(Listfile::FileKey const& file_key, ClientData* client_data, std::stop_token stop_token, IOExecutor* executor)
+      : _file_key(file_key)
+      , _client_data(client_data)
+      , _stop_token(std::move(stop_token))
+      , _executor(executor)
+    {
+    }
+
+    [[nodiscard]]
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle);
+
+    std::unique_ptr<ClientFile> await_resume();
+
+  private:
+    Listfile::FileKey _file_key;
+    ClientData* _client_data;
+    std::stop_token _stop_token;
+    IOExecutor* _executor;
+
+    std::unique_ptr<ClientFile> _result;
+    std::exception_ptr _error;
+  };
 }
 
 #endif // BLIZZARDARCHIVE_CLIENTFILE_HPP
\ No newline at end of file
@@ -2,32 +2,70 @@
 #define NOGGIT_DIRECTORYARCHIVE_HPP
 
 #include "BaseArchive.hpp"
-#include <unordered_map>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
 #include <fstream>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <tsl/robin_map.h>
 
 namespace BlizzardArchive::Archive
 {
-  class OpenFilesManager
+  /*
+  * Open files of one DirectoryArchive. Handles encode a shard, a slot and the slot's generation,
+  * so a handle that outlived its file is rejected instead of reaching whatever reuses the slot.
+  * Every thread opens files in its own shard, so concurrent readers rarely contend on a lock.
+  * A handle must not be closed while another thread is still using it.
+  */
+  class OpenFilesTable
   {
   public:
-    static OpenFilesManager* instance()
-    {
-      static OpenFilesManager instance;
-      return &instance;
-    }
+    // Returns nullptr if the file could not be opened.
+    [[nodiscard]]
+    HANDLE open(std::string const& path);
+
+    // Returns nullptr for unknown or stale handles.
+    [[nodiscard]]
+    std::ifstream* get(HANDLE handle);
 
-    std::unordered_map<HANDLE, std::ifstream>& openFiles() { return _open_files; };
+    bool close(HANDLE handle);
+    void closeAll();
 
   private:
-    OpenFilesManager() = default;
+    struct Slot
+    {
+      std::ifstream stream;
+      std::uintptr_t generation = 0;
+      bool used = false;
+    };
+
+    struct Shard
+    {
+      std::mutex mutex;
+      std::deque<Slot> slots; // deque keeps slots in place while the shard grows
+      std::vector<std::uint32_t> free_slots;
+    };
+
+    // handle = generation | shard | slot + 1, from the most to the least significant bits.
+    inline static constexpr unsigned SlotBits = 20;
+    inline static constexpr unsigned ShardBits = 4;
+    inline static constexpr unsigned GenerationShift = SlotBits + ShardBits;
+    inline static constexpr std::uintptr_t SlotMask = (std::uintptr_t(1) << SlotBits) - 1;
+    inline static constexpr std::uintptr_t ShardMask = (std::uintptr_t(1) << ShardBits) - 1;
+    inline static constexpr std::uintptr_t GenerationMask = ~std::uintptr_t(0) >> GenerationShift;
 
-    std::unordered_map<HANDLE, std::ifstream> _open_files;
+    std::array<Shard, std::size_t(1) << ShardBits> _shards;
   };
 
   class DirectoryArchive : public BaseArchive
   {
   public:
-    DirectoryArchive(std::string const& path, Locale locale, Listfile::Listfile* listfile);
+    DirectoryArchive(std::string const& path, Locale locale, Listfile::Listfile const* listfile);
     ~DirectoryArchive();
 
     [[nodiscard]]
@@ -42,9 +80,41 @@ namespace BlizzardArchive::Archive
     [[nodiscard]]
     bool exists(Listfile::FileKey const& file_key, Locale locale) const override;
 
+    [[nodiscard]]
+    bool readFile(Listfile::FileKey const& file_key, Locale locale, std::vector<char>& buffer) const override;
+
+    // Loose files are memory mapped rather than read.
+    [[nodiscard]]
+    SharedBuffer readFileShared(Listfile::FileKey const& file_key, Locale locale) const override;
+
+    /*
+    * Picks up files added or removed since construction or the previous refresh. Only directories
+    * whose modification time changed are rescanned. Safe to call while other threads read.
+    */
+    void refresh();
+
   private:
+    struct DirectoryState
+    {
+      std::filesystem::file_time_type last_write_time;
+      std::vector<std::uint32_t> files; // index keys of the files directly inside the directory
+      std::vector<std::string> subdirectories;
+    };
+
     // Returns empty string if local file does not exist
     std::string getNormalizedFilepath(Listfile::FileKey const& file_key) const;
+
+    // Indexes the directory at relative_path, and its subdirectories that are not indexed yet.
+    void scanDirectory(std::string const& relative_path);
+    void forgetDirectory(std::string const& relative_path);
+
+    // The tree is scanned once, lookups are answered from memory without touching the file system.
+    // Interned normalized path (see Listfile::PathPool) -> path relative to the archive root.
+    tsl::robin_map<std::uint32_t, std::string> _index;
+    std::unordered_map<std::string, DirectoryState> _directories;
+    mutable std::shared_mutex _index_mutex;
+
+    mutable OpenFilesTable _open_files;
   };
 
 }
@@ -44,6 +44,12 @@ namespace BlizzardArchive::Exceptions
     FileReadFailedError(const std::string& what = "") : std::runtime_error(what) {}
   };
 
+  class OperationCancelledError : public std::runtime_error
+  {
+  public:
+    OperationCancelledError(const std::string& what = "The request was cancelled before it started.") : std::runtime_error(what) {}
+  };
+
 }
 
 #endif // BLIZZARD_ARCHIVE_EXCEPTION_HPP
\ No newline at end of file
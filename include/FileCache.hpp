@@ -0,0 +1,96 @@
+#ifndef BLIZZARDARCHIVE_FILECACHE_HPP
+#define BLIZZARDARCHIVE_FILECACHE_HPP
+
+#include <SharedBuffer.hpp>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <tsl/robin_map.h>
+
+namespace BlizzardArchive
+{
+  struct FileCacheStats
+  {
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t insertions = 0;
+    std::uint64_t evictions = 0;
+    std::size_t entries = 0;
+    std::size_t bytes = 0;
+    std::size_t byte_budget = 0;
+  };
+
+  /*
+  * Byte-budgeted cache of file contents, safe to use from multiple threads.
+  * Eviction is a segmented LRU: new entries start in a probation segment and only move to the
+  * protected segment when they are hit again, so a one-off scan over many files can only
+  * evict other probationary entries and leaves the hot working set alone.
+  */
+  class FileCache
+  {
+  public:
+    explicit FileCache(std::size_t byte_budget);
+
+    // Returns an empty buffer on a miss.
+    [[nodiscard]]
+    SharedBuffer find(std::string const& key);
+
+    // Contents cached under any key with this content key, empty if there are none. Not counted as a hit or miss.
+    [[nodiscard]]
+    SharedBuffer findContent(std::string const& content_key);
+
+    /*
+    * Files larger than the whole budget are not cached. content_key identifies the contents for findContent,
+    * empty if unknown. Entries sharing their contents are each charged their full size.
+    */
+    void insert(std::string const& key, SharedBuffer const& buffer, std::string const& content_key = {});
+
+    void clear();
+
+    [[nodiscard]]
+    FileCacheStats stats() const;
+
+  private:
+    enum class Segment
+    {
+      PROBATION,
+      PROTECTED
+    };
+
+    struct Entry
+    {
+      std::string key;
+      SharedBuffer buffer;
+      Segment segment;
+      std::string content_key;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    void evict();
+
+    // Share of the budget the protected segment may grow to.
+    inline static constexpr double ProtectedShare = 0.8;
+
+    // Most recently used entries are at the front.
+    EntryList _probation;
+    EntryList _protected;
+    tsl::robin_map<std::string, EntryList::iterator> _entries;
+    // The most recently inserted entry of each content key.
+    tsl::robin_map<std::string, EntryList::iterator> _contents;
+
+    std::size_t _byte_budget;
+    std::size_t _probation_bytes = 0;
+    std::size_t _protected_bytes = 0;
+
+    std::uint64_t _hits = 0;
+    std::uint64_t _misses = 0;
+    std::uint64_t _insertions = 0;
+    std::uint64_t _evictions = 0;
+
+    mutable std::mutex _mutex;
+  };
+}
+
+#endif // BLIZZARDARCHIVE_FILECACHE_HPP
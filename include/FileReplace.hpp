@@ -0,0 +1,19 @@
+#ifndef BLIZZARDARCHIVE_FILEREPLACE_HPP
+#define BLIZZARDARCHIVE_FILEREPLACE_HPP
+
+#include <functional>
+#include <ostream>
+#include <string>
+
+namespace BlizzardArchive
+{
+  /*
+  * Writes a file next to path with write and renames it over path once it was written completely.
+  * Readers, including ones mapping path, never see a partial file. If writing or renaming fails the
+  * temporary file is removed and path is left untouched. Returns whether path was replaced.
+  */
+  [[nodiscard]]
+  bool replaceFile(std::string const& path, std::function<void(std::ostream&)> const& write);
+}
+
+#endif // BLIZZARDARCHIVE_FILEREPLACE_HPP
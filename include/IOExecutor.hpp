@@ -0,0 +1,69 @@
+#ifndef BLIZZARDARCHIVE_IOEXECUTOR_HPP
+#define BLIZZARDARCHIVE_IOEXECUTOR_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace BlizzardArchive
+{
+  /*
+  * Fixed-size thread pool running blocking archive I/O for the asynchronous loading API.
+  * Requests are executed in submission order.
+  */
+  class IOExecutor
+  {
+  public:
+    // worker_count - number of worker threads, 0 uses the hardware concurrency.
+    explicit IOExecutor(unsigned worker_count = 0);
+    ~IOExecutor();
+
+    IOExecutor(IOExecutor const&) = delete;
+    IOExecutor& operator=(IOExecutor const&) = delete;
+
+    // Library-owned executor used when none is passed explicitly.
+    static IOExecutor* instance()
+    {
+      static IOExecutor instance;
+      return &instance;
+    }
+
+    [[nodiscard]]
+    unsigned workerCount() const { return static_cast<unsigned>(_workers.size()); }
+
+    // True when called from one of the workers, which must not block waiting on other requests.
+    [[nodiscard]]
+    bool isWorkerThread() const;
+
+    /*
+    * Queues a request. If stop_token is triggered or cancelPending() is called before a worker picks
+    * the request up, on_cancel is invoked instead of work. Both run on a worker thread.
+    */
+    void submit(std::function<void()> work, std::function<void()> on_cancel, std::stop_token stop_token = {});
+
+    // Cancels every request that has not started yet.
+    void cancelPending();
+
+  private:
+    struct Request
+    {
+      std::function<void()> work;
+      std::function<void()> on_cancel;
+      std::stop_token stop_token;
+      bool cancelled = false;
+    };
+
+    void workerLoop(std::stop_token stop_token);
+
+    std::deque<Request> _requests;
+    std::mutex _mutex;
+    std::condition_variable_any _condition;
+    std::vector<std::jthread> _workers;
+  };
+}
+
+#endif // BLIZZARDARCHIVE_IOEXECUTOR_HPP
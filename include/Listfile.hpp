@@ -3,10 +3,18 @@
 
 #include <string>
 #include <cstdint>
+#include <functional>
 #include <optional>
 #include <vector>
 #include <unordered_map>
 #include <compare>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <shared_mutex>
+#include <ListfileBinary.hpp>
+#include <ListfileCompact.hpp>
+#include <PathPool.hpp>
 #include <tsl/robin_map.h>
 
 namespace BlizzardArchive::Listfile
@@ -17,48 +25,144 @@ namespace BlizzardArchive::Listfile
     Listfile() = default;
     ~Listfile()
     {
+      // The loader thread writes to this object until it is done.
+      if (_loading.valid())
+        _loading.wait();
+
       if (_listfile) free(_listfile);
     };
 
-    void initFromCSV(std::string const& listfile_path);
-    void initFromFileList(char* listfileData, size_t listfileSize);
+    Listfile(Listfile const&) = delete;
+    Listfile& operator=(Listfile const&) = delete;
+
+    // worker_count - threads parsing the file, 0 uses every core for files above ParallelParseThreshold.
+    void initFromCSV(std::string const& listfile_path, unsigned worker_count = 0);
+
+    /*
+    * Parses listfile.csv on a background thread. A missing file is reported right away, other errors
+    * by the first lookup. Lookups wait for the load to finish, file data ID based reads that never
+    * consult the listfile are not held up.
+    */
+    void initFromCSVAsync(std::string const& listfile_path);
+
+    [[nodiscard]]
+    bool isLoaded() const { return _loaded.load(std::memory_order_acquire); }
+
+    // Blocks until a background load finished, rethrowing its error if it failed.
+    void waitUntilLoaded() const
+    {
+      if (!isLoaded())
+        _loading.get();
+    }
+
+    /*
+    * Merges the names of an archive (listfile) in. Names are deduplicated across archives and stored
+    * once in an append-only arena, the returned views point there and stay valid for the lifetime of
+    * the listfile. Safe to call from several threads at once, as archives are opened in parallel.
+    */
+    std::vector<std::string_view> ingestFileList(std::string contents);
+
+    // Maps a listfile compiled by writeBinary, replacing the CSV contents.
+    void initFromBinary(std::string const& binary_path);
+
+    // Compiles the entries loaded from listfile.csv to the binary format.
+    void writeBinary(std::string const& binary_path) const;
+
+    /*
+    * Moves the loaded entries to a front-coded representation and releases the CSV buffer and both maps,
+    * only the names merged in from archive listfiles stay in the path map.
+    * Must not run concurrently with lookups. Paths returned by getPath afterwards are decoded once and
+    * kept, their views stay valid as before. See CompactListfile for bucket_size.
+    */
+    void compact(std::size_t bucket_size = 16);
+
+    // Approximate heap bytes held by the listfile. Mapped binary listfiles live in the page cache and are not counted.
+    [[nodiscard]]
+    std::size_t memoryUsage() const;
 
     std::uint32_t getFileDataID(std::string const& filename) const;
     std::string_view getPath(std::uint32_t file_data_id) const;
 
-    tsl::robin_map<std::string_view, std::uint32_t> const& pathToFileDataIDMap() const { return _path_to_fdid; };
-    tsl::robin_map<std::uint32_t, std::string_view> const& fileDataIDToPathMap() const { return _fdid_to_path; };
+    // Calls visitor(path, file_data_id) for every known path, whatever the representation.
+    // Names merged in from archive listfiles come with a file data ID of 0.
+    void forEachEntry(std::function<void(std::string_view, std::uint32_t)> const& visitor) const;
+
+    // With a binary or compacted listfile these only hold the names merged in from archive listfiles.
+    tsl::robin_map<std::string_view, std::uint32_t> const& pathToFileDataIDMap() const { waitUntilLoaded(); return _path_to_fdid; };
+    tsl::robin_map<std::uint32_t, std::string_view> const& fileDataIDToPathMap() const { waitUntilLoaded(); return _fdid_to_path; };
 
   private:
+    // Listfiles smaller than this are parsed on the calling thread only.
+    inline static constexpr std::size_t ParallelParseThreshold = 1024 * 1024;
+
     tsl::robin_map<std::string_view, std::uint32_t> _path_to_fdid;
     tsl::robin_map<std::uint32_t, std::string_view> _fdid_to_path;
+    void parseCSV(std::string const& listfile_path, unsigned worker_count = 0);
+
+    // Whether path points into the CSV buffer rather than the arena.
+    [[nodiscard]]
+    bool inCSV(std::string_view path) const;
+
+    // Frees the CSV buffer and drops the entries pointing into it. Archive names are kept.
+    void releaseCSV();
+
+    // Copies name into the arena, the caller holds _mutex exclusively.
+    [[nodiscard]]
+    std::string_view storeName(std::string_view name);
+
     char* _listfile = nullptr;
+    std::size_t _listfile_size = 0;
+
+    // Names from archive listfiles, never freed or moved before the listfile is destroyed.
+    inline static constexpr std::size_t ArenaChunkSize = 1024 * 1024;
+    std::vector<std::unique_ptr<char[]>> _arena;
+    char* _arena_cursor = nullptr;
+    std::size_t _arena_size = 0;
+    std::size_t _arena_left = 0;
+    BinaryListfile _binary;
+    CompactListfile _compact;
+
+    std::shared_future<void> _loading;
+    std::atomic<bool> _loaded = true;
+
+    // Guards the maps and the arena while archive listfiles are merged in concurrently.
+    std::shared_mutex _mutex;
   };
 
+  /*
+  * Identifies a file by file data ID, path or both. Paths are normalized once and looked up in the
+  * PathPool, so keys of known files are two integers: cheap to copy, compare and hash. Keys never add
+  * to the pool, a path it does not hold (a missing or new file) is kept by the key itself.
+  */
   class FileKey
   {
   public:
     FileKey();
-    FileKey(std::string const& filepath, Listfile* listfile = nullptr);
-    FileKey(const char* filepath, Listfile* listfile = nullptr);
-    explicit FileKey(std::uint32_t file_data_id, Listfile* listfile = nullptr);
+    FileKey(std::string const& filepath, Listfile const* listfile = nullptr);
+    FileKey(const char* filepath, Listfile const* listfile = nullptr);
+    explicit FileKey(std::uint32_t file_data_id, Listfile const* listfile = nullptr);
     FileKey(std::string const& filepath, std::uint32_t file_data_id);
     FileKey(const char* filepath, std::uint32_t file_data_id);
 
-    FileKey(FileKey const& other);
-    FileKey& operator= (FileKey const& other);
+    FileKey(FileKey const& other) = default;
+    FileKey& operator= (FileKey const& other) = default;
 
-    FileKey(FileKey&& other) noexcept;
-    FileKey& operator= (FileKey&& other) noexcept;
+    FileKey(FileKey&& other) noexcept = default;
+    FileKey& operator= (FileKey&& other) noexcept = default;
 
     [[nodiscard]]
-    bool hasFilepath() const { return _file_path.has_value(); };
+    bool hasFilepath() const { return _path_id != NoPath || _unpooled_path; };
 
     [[nodiscard]]
     bool hasFileDataID() const { return static_cast<bool>(_file_data_id); };
 
+    // Throws std::bad_optional_access if the key has no path.
     [[nodiscard]]
-    std::string const& filepath() const { return _file_path.value(); };
+    std::string const& filepath() const;
+
+    // PathPool ID of the normalized path, NoPath if the key has none or the pool does not hold it.
+    [[nodiscard]]
+    std::uint32_t pathID() const { return _unpooled_path ? PathPool::instance().find(*_unpooled_path) : _path_id; };
 
     [[nodiscard]]
     std::uint32_t fileDataID() const { return _file_data_id; };
@@ -66,16 +170,52 @@ namespace BlizzardArchive::Listfile
     [[nodiscard]]
     std::string stringRepr() const;
 
-    void setFilepath(std::string const& path) { _file_path = path; }
+    // Hashes both components, see ResolvedHash.
+    [[nodiscard]]
+    std::size_t hash() const;
+
+    // MPQ name hashes of the path, cached in the pool for pooled paths.
+    [[nodiscard]]
+    Archive::MPQNameHash mpqHash() const;
+
+    // Expects a normalized path.
+    void setFilepath(std::string const& path);
     void setFileDataID(std::uint32_t file_data_id) { _file_data_id = file_data_id; }
     bool deduceOtherComponent(const Listfile* listfile);
 
+    // Compares file data IDs if both keys have one, paths otherwise.
     bool operator==(FileKey const& rhs) const;
     bool operator<(FileKey const& rhs) const;
 
+    /*
+    * Hash and equality over both components, for unordered containers. operator== matches a key by
+    * either component and can not be hashed consistently, so keys stored together should be
+    * resolved the same way (see deduceOtherComponent).
+    */
+    struct ResolvedHash
+    {
+      std::size_t operator()(FileKey const& file_key) const noexcept { return file_key.hash(); }
+    };
+
+    struct ResolvedEqual
+    {
+      bool operator()(FileKey const& lhs, FileKey const& rhs) const noexcept
+      {
+        return lhs.fileDataID() == rhs.fileDataID() && lhs.hasFilepath() == rhs.hasFilepath()
+          && (!lhs.hasFilepath() || lhs.samePath(rhs));
+      }
+    };
+
+    inline static constexpr std::uint32_t NoPath = 0xFFFFFFFF;
+
   private:
+    // Both keys must have a path.
+    [[nodiscard]]
+    bool samePath(FileKey const& rhs) const;
+
     std::uint32_t _file_data_id = 0;
-    std::optional<std::string> _file_path;
+    std::uint32_t _path_id = NoPath;
+    std::shared_ptr<std::string const> _unpooled_path; // set instead of _path_id for paths the pool does not hold
   };
 }
 
@@ -0,0 +1,98 @@
+#ifndef BLIZZARDARCHIVE_LISTFILEBINARY_HPP
+#define BLIZZARDARCHIVE_LISTFILEBINARY_HPP
+
+#include <SharedBuffer.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace BlizzardArchive::Listfile
+{
+  /*
+  * Compiled listfile, used straight from a read-only mapping with no parsing. Lookups read the image
+  * in place, so its pages are shared through the page cache by every process mapping the same file.
+  *
+  * Layout (little-endian, every section aligned to 8 bytes):
+  *   Header
+  *   path_offsets[path_count + 1]   start of each path in the blob, the last one being the blob size
+  *   path_fdids[path_count]         file data ID of each path
+  *   pilots[bucket_count]           hash-and-displace pilots of the path hash
+  *   slots[slot_count]              path index stored at each hash position, EmptySlot if unused
+  *   fdids[fdid_count]              file data IDs, sorted
+  *   fdid_paths[fdid_count]         path index of each file data ID
+  *   blob[blob_size]                normalized paths, sorted and concatenated
+  *
+  * The path hash is a PTHash style perfect hash: keys are spread over buckets and each bucket gets the
+  * first pilot placing all its keys in free slots. Slots are kept at about 98% load rather than exactly
+  * one per key, which keeps building fast at the cost of 2% unused slots.
+  */
+  class BinaryListfile
+  {
+  public:
+    BinaryListfile() = default;
+
+    // Throws std::runtime_error if the image is not a binary listfile.
+    explicit BinaryListfile(SharedBuffer image);
+
+    // Compiles the given entries to a binary listfile at path. The file is replaced atomically,
+    // so processes still mapping the previous version keep reading it.
+    static void write(std::string const& path
+      , std::vector<std::pair<std::string_view, std::uint32_t>> paths
+      , std::vector<std::pair<std::uint32_t, std::string_view>> file_data_ids);
+
+    // 0 if the path is unknown.
+    [[nodiscard]]
+    std::uint32_t getFileDataID(std::string_view path) const;
+
+    // Empty if the file data ID is unknown.
+    [[nodiscard]]
+    std::string_view getPath(std::uint32_t file_data_id) const;
+
+    // Calls visitor(path, file_data_id) for every path, in sorted order.
+    void forEachEntry(std::function<void(std::string_view, std::uint32_t)> const& visitor) const;
+
+    [[nodiscard]]
+    std::size_t pathCount() const { return _header.path_count; }
+
+    [[nodiscard]]
+    std::size_t fileDataIDCount() const { return _header.fdid_count; }
+
+    explicit operator bool() const { return static_cast<bool>(_image); }
+
+    inline static constexpr char Magic[4] = { 'B', 'L', 'F', '1' };
+    inline static constexpr std::uint32_t EmptySlot = 0xFFFFFFFF;
+
+  private:
+    struct Header
+    {
+      char magic[4];
+      std::uint32_t path_count;
+      std::uint32_t fdid_count;
+      std::uint32_t bucket_count;
+      std::uint32_t slot_count;
+      std::uint32_t reserved;
+      std::uint64_t seed;
+      std::uint64_t blob_size;
+    };
+
+    [[nodiscard]]
+    std::string_view pathAt(std::uint32_t index) const;
+
+    SharedBuffer _image;
+    Header _header = {};
+
+    std::uint32_t const* _path_offsets = nullptr;
+    std::uint32_t const* _path_fdids = nullptr;
+    std::uint32_t const* _pilots = nullptr;
+    std::uint32_t const* _slots = nullptr;
+    std::uint32_t const* _fdids = nullptr;
+    std::uint32_t const* _fdid_paths = nullptr;
+    char const* _blob = nullptr;
+  };
+}
+
+#endif // BLIZZARDARCHIVE_LISTFILEBINARY_HPP
@@ -0,0 +1,81 @@
+#ifndef BLIZZARDARCHIVE_LISTFILECOMPACT_HPP
+#define BLIZZARDARCHIVE_LISTFILECOMPACT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace BlizzardArchive::Listfile
+{
+  /*
+  * Front-coded listfile. Paths are sorted and grouped in buckets, the first path of a bucket is stored
+  * in full and every following one as the length of the prefix it shares with its predecessor plus the
+  * remaining suffix. Listfile paths share long directory prefixes, so this is several times smaller
+  * than keeping the raw paths and two hash maps.
+  *
+  * Lookups binary search the bucket heads, then decode at most bucket_size paths: bigger buckets
+  * compress better and look up slower. Paths returned by getPath are kept decoded, so only the paths
+  * asked for are held in full.
+  */
+  class CompactListfile
+  {
+  public:
+    CompactListfile() = default;
+
+    CompactListfile(std::vector<std::pair<std::string_view, std::uint32_t>> paths
+      , std::vector<std::pair<std::uint32_t, std::string_view>> file_data_ids
+      , std::size_t bucket_size);
+
+    // 0 if the path is unknown.
+    [[nodiscard]]
+    std::uint32_t getFileDataID(std::string_view path) const;
+
+    // Empty if the file data ID is unknown. The view stays valid for the lifetime of the listfile.
+    [[nodiscard]]
+    std::string_view getPath(std::uint32_t file_data_id) const;
+
+    // Calls visitor(path, file_data_id) for every path, in sorted order.
+    void forEachEntry(std::function<void(std::string_view, std::uint32_t)> const& visitor) const;
+
+    [[nodiscard]]
+    std::size_t pathCount() const { return _path_fdids.size(); }
+
+    [[nodiscard]]
+    std::size_t memoryUsage() const;
+
+    explicit operator bool() const { return _bucket_size != 0; }
+
+  private:
+    [[nodiscard]]
+    std::string_view bucketHead(std::size_t bucket) const;
+
+    // Decodes the paths of a bucket in order until visitor returns false.
+    template<typename Visitor>
+    void visitBucket(std::size_t bucket, std::string& path, Visitor&& visitor) const;
+
+    std::size_t _bucket_size = 0;
+    std::vector<char> _data;
+    std::vector<std::uint32_t> _bucket_offsets;
+    std::vector<std::uint32_t> _path_fdids;
+    std::vector<std::uint32_t> _fdids;
+    std::vector<std::uint32_t> _fdid_paths;
+
+    struct DecodedPaths
+    {
+      std::shared_mutex mutex;
+      std::unordered_map<std::uint32_t, std::string> paths;
+      std::size_t size = 0;
+    };
+
+    std::unique_ptr<DecodedPaths> _decoded = std::make_unique<DecodedPaths>();
+  };
+}
+
+#endif // BLIZZARDARCHIVE_LISTFILECOMPACT_HPP
@@ -0,0 +1,43 @@
+#ifndef BLIZZARDARCHIVE_LISTFILEKERNELS_HPP
+#define BLIZZARDARCHIVE_LISTFILEKERNELS_HPP
+
+#include <cstddef>
+
+/*
+* Text processing kernels used to parse listfiles. Every kernel has a scalar, SSE4.1, AVX2 and
+* AVX-512BW implementation; the widest one supported by the CPU is picked at runtime.
+*/
+namespace BlizzardArchive::Listfile::Kernels
+{
+  enum class InstructionSet
+  {
+    SCALAR,
+    SSE41,
+    AVX2,
+    AVX512BW
+  };
+
+  // Lowercases ASCII letters, turns '\\' into '/' and both '\r' and '\n' into '\0', in place.
+  void normalizeText(char* data, std::size_t size);
+
+  [[nodiscard]]
+  std::size_t countByte(char const* data, std::size_t size, char value);
+
+  // First position in [begin, end) holding first or second, end if there is none.
+  [[nodiscard]]
+  char* findEitherByte(char* begin, char* end, char first, char second);
+
+  [[nodiscard]]
+  inline char* findByte(char* begin, char* end, char value) { return findEitherByte(begin, end, value, value); }
+
+  [[nodiscard]]
+  InstructionSet activeInstructionSet();
+
+  [[nodiscard]]
+  bool isSupported(InstructionSet instruction_set);
+
+  // Switches the kernels to another implementation, for benchmarking. Returns false if the CPU lacks it.
+  bool forceInstructionSet(InstructionSet instruction_set);
+}
+
+#endif // BLIZZARDARCHIVE_LISTFILEKERNELS_HPP
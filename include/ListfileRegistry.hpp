@@ -0,0 +1,58 @@
+#ifndef BLIZZARDARCHIVE_LISTFILEREGISTRY_HPP
+#define BLIZZARDARCHIVE_LISTFILEREGISTRY_HPP
+
+#include <Listfile.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace BlizzardArchive::Listfile
+{
+  /*
+  * Hands out one Listfile per listfile on disk, shared by every client asking for it while any of
+  * them holds it. Shared listfiles are read-only, nobody can merge names into another client's
+  * listfile. Files are identified by canonical path, size and modification time, so an updated
+  * listfile is loaded again rather than served stale.
+  */
+  class ListfileRegistry
+  {
+  public:
+    ListfileRegistry(ListfileRegistry const&) = delete;
+    ListfileRegistry& operator=(ListfileRegistry const&) = delete;
+
+    [[nodiscard]]
+    static ListfileRegistry& instance();
+
+    /*
+    * Listfile of a project directory: listfile.csv, parsed in the background. With use_binary, listfile.bin
+    * is mapped instead if it is not older than the CSV. Binary listfiles answer lookups and forEachEntry
+    * but leave pathToFileDataIDMap and fileDataIDToPathMap empty. Throws ListfileNotFoundError if there is
+    * no listfile to load.
+    */
+    [[nodiscard]]
+    std::shared_ptr<Listfile const> acquire(std::string const& directory, bool use_binary = false);
+
+    [[nodiscard]]
+    std::shared_ptr<Listfile const> acquireCSV(std::string const& csv_path);
+
+    // Throws std::runtime_error if the file is not a valid binary listfile.
+    [[nodiscard]]
+    std::shared_ptr<Listfile const> acquireBinary(std::string const& binary_path);
+
+  private:
+    ListfileRegistry() = default;
+
+    // Empty if the file does not exist.
+    [[nodiscard]]
+    static std::string identityOf(std::string const& path);
+
+    template<typename Loader>
+    std::shared_ptr<Listfile const> acquire(std::string const& path, Loader&& loader);
+
+    std::unordered_map<std::string, std::weak_ptr<Listfile const>> _listfiles;
+    std::mutex _mutex;
+  };
+}
+
+#endif // BLIZZARDARCHIVE_LISTFILEREGISTRY_HPP
@@ -2,6 +2,17 @@
 #define BLIZZARDARCHIVE_MPQARCHIVE_HPP
 
 #include <BaseArchive.hpp>
+#include <MPQHash.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#ifdef BLIZZARD_ARCHIVE_NATIVE_MPQ
+#include <NativeMPQReader.hpp>
+#endif
 
 namespace BlizzardArchive::Listfile
 {
@@ -14,6 +25,7 @@ namespace BlizzardArchive::Archive
   class MPQArchive : public BaseArchive
   {
   public:
+    // The names of the archive's (listfile) are merged into listfile.
     MPQArchive(std::string const& path, Locale locale, Listfile::Listfile* listfile);
     ~MPQArchive() override;
 
@@ -29,10 +41,104 @@ namespace BlizzardArchive::Archive
     [[nodiscard]]
     bool exists(Listfile::FileKey const& file_key, Locale locale) const override;
 
+    [[nodiscard]]
+    bool readFile(Listfile::FileKey const& file_key, Locale locale, std::vector<char>& buffer) const override;
+
+    [[nodiscard]]
+    std::optional<std::uint64_t> getFileOffset(Listfile::FileKey const& file_key, Locale locale) const override;
+
+    // Enumerates the archive through the names of its (listfile). Patched archives are not enumerable.
+    bool forEachFile(std::function<void(std::string const&)> const& callback) const override;
+
+    // MD5 or CRC32 from (attributes) for the files of the (listfile). Patched archives are not enumerable.
+    bool forEachManifestEntry(std::function<void(ManifestEntry&&)> const& callback) const override;
+
+#ifdef BLIZZARD_ARCHIVE_NATIVE_MPQ
+    // Reads through NativeMPQReader alone, UNSUPPORTED for what has to go through StormLib.
+    [[nodiscard]]
+    NativeMPQReader::ReadResult readFileNative(Listfile::FileKey const& file_key, std::vector<char>& buffer) const;
+#endif
+
+    // Applies a patch archive on top of this one. Must be called before the archive is used for reading.
+    bool openPatchArchive(std::string const& path, std::string const& prefix);
+
     HANDLE getHandle() const { return _handle; }
 
   private:
+    // What the archive's own hash table says about a name. UNKNOWN leaves the decision to StormLib.
+    enum class HashLookup
+    {
+      ABSENT,
+      PRESENT,
+      UNKNOWN
+    };
+
+    // Layout of StormLib's TMPQHash and TMPQBlock.
+    struct HashEntry
+    {
+      std::uint32_t name_a;
+      std::uint32_t name_b;
+      std::uint16_t locale;
+      std::uint8_t platform;
+      std::uint8_t reserved;
+      std::uint32_t block_index;
+    };
+
+    struct BlockEntry
+    {
+      std::uint32_t file_position;
+      std::uint32_t compressed_size;
+      std::uint32_t file_size;
+      std::uint32_t flags;
+    };
+
+    // Copies the hash table, the block flags and positions out of StormLib, if the archive has classic tables.
+    void loadHashTable();
+
+    // PRESENT is only returned for the neutral locale entry, whose block index goes to block_index if given.
+    [[nodiscard]]
+    HashLookup lookupHashTable(MPQNameHash const& name_hash, std::uint32_t* block_index = nullptr) const;
+
+    [[nodiscard]]
+    HashLookup lookupHashTable(Listfile::FileKey const& file_key, std::uint32_t* block_index = nullptr) const;
+
+    // True if every live hash table entry belongs to a name of the (listfile) or to an internal file.
+    [[nodiscard]]
+    bool listfileCoversHashTable() const;
+
+#ifdef BLIZZARD_ARCHIVE_NATIVE_MPQ
+    // Maps the archive for NativeMPQReader, given the blocks of the classic block table.
+    void loadNativeReader(std::vector<BlockEntry> const& blocks, std::uint64_t header_offset);
+#endif
+
+    // StormLib archive handles are not safe to share between threads, so concurrent readers
+    // borrow a private handle from a pool that grows up to the number of simultaneous readers.
+    [[nodiscard]]
+    HANDLE acquireHandle() const;
+    void releaseHandle(HANDLE handle) const;
+
     HANDLE _handle = nullptr;
+    std::vector<std::pair<std::string, std::string>> _patches;
+
+    // Probed with the hashes cached per path, so a name missing from most archives is rejected
+    // without StormLib rehashing it in every one of them.
+    std::vector<HashEntry> _hash_table;
+    std::vector<std::uint32_t> _block_flags;
+    // Where each block's data starts in the archive file, as SFileInfoByteOffset reports it.
+    std::vector<std::uint64_t> _block_positions;
+
+#ifdef BLIZZARD_ARCHIVE_NATIVE_MPQ
+    // Reads unpatched files without StormLib when set, StormLib handles what it does not support.
+    std::unique_ptr<NativeMPQReader> _native_reader;
+#endif
+
+    // Names of the (listfile), owned by the shared Listfile's arena.
+    std::vector<std::string_view> _names;
+    // Whether _names lists every file, only then the archive can be enumerated through them.
+    bool _names_complete = false;
+
+    mutable std::vector<HANDLE> _idle_handles;
+    mutable std::mutex _pool_mutex;
   };
 }
 
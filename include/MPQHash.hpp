@@ -0,0 +1,30 @@
+#ifndef BLIZZARDARCHIVE_MPQHASH_HPP
+#define BLIZZARDARCHIVE_MPQHASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace BlizzardArchive::Archive
+{
+  // The three MPQ name hashes: the hash table start index and the two hashes identifying the name.
+  struct MPQNameHash
+  {
+    std::uint32_t table_index = 0;
+    std::uint32_t name_a = 0;
+    std::uint32_t name_b = 0;
+  };
+
+  // Same hashes as StormLib's, which ignore case and treat '/' as '\\'. Internal and WoW style names hash equally.
+  [[nodiscard]]
+  MPQNameHash hashMPQName(std::string_view name);
+
+  // Base encryption key of a file, the file key hash of its name without the directory.
+  [[nodiscard]]
+  std::uint32_t mpqFileKey(std::string_view name);
+
+  // Decrypts data in place. Trailing bytes that do not fill a 32-bit word are left as they are, like StormLib does.
+  void decryptMPQData(void* data, std::size_t size, std::uint32_t key);
+}
+
+#endif // BLIZZARDARCHIVE_MPQHASH_HPP
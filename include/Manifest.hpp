@@ -0,0 +1,74 @@
+#ifndef BLIZZARDARCHIVE_MANIFEST_HPP
+#define BLIZZARDARCHIVE_MANIFEST_HPP
+
+#include <Listfile.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace BlizzardArchive
+{
+  enum class ManifestHashType : std::uint8_t
+  {
+    NONE,         // nothing recorded the contents, the file always counts as changed
+    CONTENT_KEY,  // CASC content key
+    MD5,          // MPQ (attributes)
+    CRC32         // MPQ (attributes), in the first 4 bytes of the hash
+  };
+
+  struct ManifestEntry
+  {
+    std::uint32_t file_data_id = 0; // CASC files
+    std::string path;               // MPQ files, normalized
+    std::uint64_t size = 0;
+    ManifestHashType hash_type = ManifestHashType::NONE;
+    std::array<std::uint8_t, 16> hash {};
+
+    [[nodiscard]]
+    Listfile::FileKey fileKey() const;
+  };
+
+  struct ManifestDiff
+  {
+    std::vector<Listfile::FileKey> added;
+    std::vector<Listfile::FileKey> changed;
+    std::vector<Listfile::FileKey> removed;
+  };
+
+  /*
+  * Size and content hash of every file of a client, as recorded by the archives' own indices so
+  * exporting it reads no file data. Diffing the manifests of two builds gives the files to extract again.
+  */
+  class Manifest
+  {
+  public:
+    Manifest() = default;
+
+    // Entries later in the list replace earlier ones with the same key, as later archives override earlier ones.
+    explicit Manifest(std::vector<ManifestEntry> entries);
+
+    // Throws std::runtime_error if the file can not be written.
+    void save(std::string const& path) const;
+
+    // Throws std::runtime_error if the file is missing or not a manifest.
+    void load(std::string const& path);
+
+    // What changed from this manifest to the newer one. Hashes of different types never match.
+    [[nodiscard]]
+    ManifestDiff diff(Manifest const& newer) const;
+
+    [[nodiscard]]
+    std::span<ManifestEntry const> entries() const { return _entries; }
+
+    inline static constexpr char Magic[4] = { 'B', 'A', 'M', '1' };
+
+  private:
+    // Sorted by file data ID, then path.
+    std::vector<ManifestEntry> _entries;
+  };
+}
+
+#endif // BLIZZARDARCHIVE_MANIFEST_HPP
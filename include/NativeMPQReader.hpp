@@ -0,0 +1,69 @@
+#ifndef BLIZZARDARCHIVE_NATIVEMPQREADER_HPP
+#define BLIZZARDARCHIVE_NATIVEMPQREADER_HPP
+
+#include <SharedBuffer.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace BlizzardArchive::Archive
+{
+  /*
+  * Read-only access to the file data of an MPQ archive without StormLib, for the common case: stored
+  * or zlib compressed sectors, optionally encrypted. The archive is mapped once, so any number of threads
+  * read it at the same time without handles, and the sectors of large files are decompressed in parallel.
+  * Tables are not parsed here, MPQArchive hands over the block table StormLib already loaded.
+  * Anything else (PKWARE, bzip2, LZMA, ADPCM, Huffman, patch files) is reported as unsupported for the
+  * caller to read through StormLib instead.
+  *
+  * Only built with BLIZZARD_ARCHIVE_NATIVE_MPQ, it needs zlib.
+  */
+  class NativeMPQReader
+  {
+  public:
+    struct Block
+    {
+      std::uint64_t offset;          // from the start of the MPQ header
+      std::uint32_t compressed_size;
+      std::uint32_t file_size;
+      std::uint32_t flags;
+    };
+
+    enum class ReadResult
+    {
+      OK,
+      UNSUPPORTED,
+      FAILED
+    };
+
+    // header_offset - position of the MPQ header in the archive file, after any user data.
+    NativeMPQReader(SharedBuffer archive, std::uint64_t header_offset, std::uint32_t sector_size, std::vector<Block> blocks);
+
+    /*
+    * Reads the file in block block_index. name is the full name of the file in the archive, needed to
+    * decrypt it. The buffer is left in an unspecified state unless OK is returned.
+    */
+    [[nodiscard]]
+    ReadResult read(std::uint32_t block_index, std::string_view name, std::vector<char>& buffer) const;
+
+    // Files with at least this many sectors are decompressed by several threads.
+    inline static constexpr std::size_t ParallelSectorThreshold = 64;
+
+    // Sectors decompressed per thread, at least.
+    inline static constexpr std::size_t SectorsPerTask = 32;
+
+  private:
+    // Decrypts (into scratch) and decompresses one sector or single unit file into output.
+    [[nodiscard]]
+    ReadResult readSector(Block const& block, char const* data, std::size_t stored_size
+      , char* output, std::size_t output_size, std::uint32_t key, std::vector<char>& scratch) const;
+
+    SharedBuffer _archive;
+    std::uint64_t _header_offset;
+    std::uint32_t _sector_size;
+    std::vector<Block> _blocks;
+  };
+}
+
+#endif // BLIZZARDARCHIVE_NATIVEMPQREADER_HPP
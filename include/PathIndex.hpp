@@ -0,0 +1,87 @@
+#ifndef BLIZZARDARCHIVE_PATHINDEX_HPP
+#define BLIZZARDARCHIVE_PATHINDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <tsl/robin_map.h>
+
+namespace BlizzardArchive::Listfile
+{
+  class Listfile;
+
+  /*
+  * Sorted snapshot of the paths of a Listfile, for queries that exact lookups can not answer:
+  * everything under a prefix or directory, everything with an extension, glob patterns.
+  * Prefix and extension queries return ranges of the index without scanning it.
+  * Immutable once built, so it can be queried from any number of threads.
+  */
+  class PathIndex
+  {
+  public:
+    struct Entry
+    {
+      std::string_view path;
+      std::uint32_t file_data_id;
+    };
+
+    struct DirectoryListing
+    {
+      std::vector<Entry> files;
+      std::vector<std::string_view> subdirectories; // full paths, without the trailing '/'
+    };
+
+    PathIndex() = default;
+    explicit PathIndex(Listfile const& listfile);
+
+    PathIndex(PathIndex const&) = delete;
+    PathIndex& operator=(PathIndex const&) = delete;
+    PathIndex(PathIndex&&) noexcept = default;
+    PathIndex& operator=(PathIndex&&) noexcept = default;
+
+    // Every path starting with prefix, in sorted order.
+    [[nodiscard]]
+    std::span<Entry const> withPrefix(std::string_view prefix) const;
+
+    // Files directly inside directory and its immediate subdirectories. Subtrees are skipped by
+    // binary search, the cost grows with the size of the listing only.
+    [[nodiscard]]
+    DirectoryListing listDirectory(std::string_view directory) const;
+
+    // Every file in directory and below it.
+    [[nodiscard]]
+    std::span<Entry const> listDirectoryRecursive(std::string_view directory) const;
+
+    // Every path with the extension, given with or without the leading dot, in sorted order.
+    [[nodiscard]]
+    std::span<Entry const> withExtension(std::string_view extension) const;
+
+    /*
+    * Paths matching a glob: '?' matches one character and '*' any run of characters except '/',
+    * "**" also matches across directories. Only the range sharing the literal prefix of the
+    * pattern is scanned, or the paths with the extension for patterns like "*.m2".
+    */
+    [[nodiscard]]
+    std::vector<Entry> glob(std::string_view pattern) const;
+
+    [[nodiscard]]
+    std::size_t size() const { return _entries.size(); }
+
+  private:
+    [[nodiscard]]
+    std::span<Entry const> prefixRange(std::string_view normalized_prefix) const;
+
+    std::unique_ptr<char[]> _blob;
+    std::vector<Entry> _entries;
+
+    // Entries grouped by extension, sorted by path within a group.
+    std::vector<Entry> _entries_by_extension;
+    tsl::robin_map<std::string_view, std::pair<std::size_t, std::size_t>> _extension_ranges;
+  };
+}
+
+#endif // BLIZZARDARCHIVE_PATHINDEX_HPP
@@ -0,0 +1,95 @@
+#ifndef BLIZZARDARCHIVE_PATHPOOL_HPP
+#define BLIZZARDARCHIVE_PATHPOOL_HPP
+
+#include <MPQHash.hpp>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <tsl/robin_map.h>
+
+namespace BlizzardArchive::Listfile
+{
+  /*
+  * Process wide pool of normalized paths. Every distinct path is stored once and identified by a
+  * 32-bit ID, so equal paths have equal IDs and keys compare and hash by ID. Entries are never moved
+  * or freed: references returned by path() stay valid for the lifetime of the process.
+  *
+  * The pool only grows with distinct paths of the client: archive and listfile names and the loose
+  * files of directory archives. That is bounded by the client's file set, a few million paths for a
+  * full retail listfile, and capped at MaxChunks * ChunkSize entries. FileKeys built from other input
+  * only find() their path and keep it themselves if the pool does not hold it.
+  */
+  class PathPool
+  {
+  public:
+    PathPool(PathPool const&) = delete;
+    PathPool& operator=(PathPool const&) = delete;
+
+    [[nodiscard]]
+    static PathPool& instance();
+
+    // Returns the ID of an already normalized path, adding it to the pool if needed.
+    [[nodiscard]]
+    std::uint32_t intern(std::string_view path);
+
+    // ID of a path already in the pool, NotFound otherwise. Never adds the path.
+    [[nodiscard]]
+    std::uint32_t find(std::string_view path) const;
+
+    [[nodiscard]]
+    std::string const& path(std::uint32_t id) const { return entry(id).path; }
+
+    [[nodiscard]]
+    std::size_t hash(std::uint32_t id) const { return entry(id).hash; }
+
+    // MPQ name hashes of the path, computed on first use and shared by every archive probed for it.
+    [[nodiscard]]
+    Archive::MPQNameHash mpqHash(std::uint32_t id) const;
+
+    [[nodiscard]]
+    std::size_t size() const { return _size.load(std::memory_order_acquire); }
+
+    // ID of the empty path, always present.
+    inline static constexpr std::uint32_t EmptyPath = 0;
+
+    // Returned by find() for paths that are not in the pool, never a valid ID.
+    inline static constexpr std::uint32_t NotFound = 0xFFFFFFFF;
+
+  private:
+    PathPool();
+    ~PathPool();
+
+    struct Entry
+    {
+      std::string path;
+      std::size_t hash = 0;
+
+      // Threads racing to fill these store the same values.
+      mutable std::atomic<bool> mpq_hashed = false;
+      mutable std::atomic<std::uint32_t> mpq_hash[3] = {};
+    };
+
+    // Entries live in fixed size chunks that are allocated as the pool grows and never reallocated.
+    inline static constexpr std::uint32_t ChunkBits = 14;
+    inline static constexpr std::uint32_t ChunkSize = 1 << ChunkBits;
+    inline static constexpr std::uint32_t MaxChunks = 1 << 14;
+
+    [[nodiscard]]
+    Entry const& entry(std::uint32_t id) const
+    {
+      return _chunks[id >> ChunkBits].load(std::memory_order_acquire)[id & (ChunkSize - 1)];
+    }
+
+    std::array<std::atomic<Entry*>, MaxChunks> _chunks = {};
+    std::atomic<std::uint32_t> _size = 0;
+
+    tsl::robin_map<std::string_view, std::uint32_t> _ids;
+    mutable std::shared_mutex _mutex;
+  };
+}
+
+#endif // BLIZZARDARCHIVE_PATHPOOL_HPP
@@ -0,0 +1,75 @@
+#ifndef BLIZZARDARCHIVE_SHAREDBUFFER_HPP
+#define BLIZZARDARCHIVE_SHAREDBUFFER_HPP
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace BlizzardArchive
+{
+  /*
+  * Immutable, reference counted file contents. Copies share the same bytes, which stay alive
+  * for as long as any copy does, whatever owns the underlying storage.
+  */
+  class SharedBuffer
+  {
+  public:
+    SharedBuffer() = default;
+
+    explicit SharedBuffer(std::vector<char>&& data)
+    {
+      auto owner = std::make_shared<std::vector<char> const>(std::move(data));
+      _data = owner->data();
+      _size = owner->size();
+      _owner = std::move(owner);
+    }
+
+    SharedBuffer(std::shared_ptr<void const> owner, char const* data, std::size_t size)
+      : _owner(std::move(owner))
+      , _data(data)
+      , _size(size)
+    {
+    }
+
+    [[nodiscard]]
+    char const* data() const { return _data; }
+
+    [[nodiscard]]
+    std::size_t size() const { return _size; }
+
+    [[nodiscard]]
+    std::span<char const> span() const { return { _data, _size }; }
+
+    // False for a default constructed buffer, which stands for "no file".
+    explicit operator bool() const { return static_cast<bool>(_owner); }
+
+    // True if the bytes are a mapping of a file on disk rather than memory owned by the buffer.
+    [[nodiscard]]
+    bool isMapped() const { return _mapped; }
+
+    /*
+    * Maps a file on disk read-only, without copying it to user space. Small files, for which a mapping
+    * costs more than a read, and files that can not be mapped are read into memory instead.
+    * Returns an empty buffer if the file can not be opened.
+    * Replacing the file (writing a new one and renaming it over) is safe while it is mapped, the
+    * mapping keeps the old contents. Writing it in place is not: truncating it (as cp does) faults
+    * the reader on POSIX systems, other writes change the bytes under the reader. Mappings should
+    * therefore not be kept beyond the read, see isMapped.
+    */
+    [[nodiscard]]
+    static SharedBuffer mapFile(std::string const& path);
+
+    // Files smaller than this are read rather than mapped.
+    inline static constexpr std::size_t MapThreshold = 64 * 1024;
+
+  private:
+    std::shared_ptr<void const> _owner;
+    char const* _data = nullptr;
+    std::size_t _size = 0;
+    bool _mapped = false;
+  };
+}
+
+#endif // BLIZZARDARCHIVE_SHAREDBUFFER_HPP
@@ -3,7 +3,7 @@
 
 using namespace BlizzardArchive::Archive;
 
-BaseArchive::BaseArchive(std::string const& path, Locale locale, Listfile::Listfile* listfile)
+BaseArchive::BaseArchive(std::string const& path, Locale locale, Listfile::Listfile const* listfile)
   : _locale(locale)
   , _path(path)
   , _listfile(listfile)
@@ -1,16 +1,77 @@
 #include <CASCArchive.hpp>
 
 #include <Exception.hpp>
+#include <FileReplace.hpp>
 #include <CascLib.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <mutex>
 
+namespace fs = std::filesystem;
 
 using namespace BlizzardArchive::Archive;
 
+namespace
+{
+  // magic, build number, locale mask, word count, then the bitmap words.
+  constexpr std::array<char, 4> FileDataIDIndexMagic { 'C', 'F', 'D', '1' };
+  constexpr std::size_t FileDataIDIndexHeaderSize = 16;
+
+  // Prefetched data is thrown away, only CascLib's cache keeps it.
+  constexpr std::size_t PrefetchChunkSize = 1024 * 1024;
+
+  // Storage record of the file as resolved from the root and encoding manifests, without reading it.
+  bool getFullInfo(HANDLE storage, std::uint32_t file_data_id, CASC_FILE_FULL_INFO& info)
+  {
+    HANDLE file_handle = nullptr;
+
+    if (!file_data_id || !CascOpenFile(storage, CASC_FILE_DATA_ID(file_data_id), 0, CASC_OPEN_BY_FILEID, &file_handle))
+      return false;
+
+    bool const status = CascGetFileInfo(file_handle, CascFileFullInfo, &info, sizeof(info), nullptr);
+    CascCloseFile(file_handle);
+    return status;
+  }
+
+  // Calls visitor for every root manifest entry available for the locale mask. False if the storage can not be enumerated.
+  template<typename Visitor>
+  bool forEachRootEntry(HANDLE storage, std::uint32_t locale_mask, Visitor&& visitor)
+  {
+    CASC_FIND_DATA find_data;
+    HANDLE find_handle = CascFindFirstFile(storage, "*", &find_data, nullptr);
+
+    if (!find_handle || find_handle == INVALID_HANDLE_VALUE)
+      return false;
+
+    do
+    {
+      // Entries without locale flags are shared by every locale. A mask of 0 opens all of them, so does not filter.
+      if (find_data.dwFileDataId == CASC_INVALID_ID
+        || (locale_mask && find_data.dwLocaleFlags && !(find_data.dwLocaleFlags & locale_mask)))
+        continue;
+
+      visitor(find_data);
+    }
+    while (CascFindNextFile(find_handle, &find_data));
+
+    CascFindClose(find_handle);
+    return true;
+  }
+}
+
 CASCArchive::CASCArchive(std::string const& path
                          , std::string const& cache_path
                          , Locale locale
                          , OpenMode open_mode
-                         , Listfile::Listfile* listfile)
+                         , Listfile::Listfile const* listfile
+                         , std::string const& file_index_directory)
   : BaseArchive(path, locale, listfile)
 {
   switch (open_mode)
@@ -99,6 +160,7 @@ CASCArchive::CASCArchive(std::string const& path
         break;
       }
 
+      _locale_mask = args.dwLocaleMask;
 
       if (!CascOpenStorageEx(nullptr, &args, false, &_handle))
       {
@@ -110,27 +172,98 @@ CASCArchive::CASCArchive(std::string const& path
     }
   }
 
+  buildFileDataIDIndex(file_index_directory);
 }
 
-bool CASCArchive::openFile(Listfile::FileKey const& file_key, Locale locale, HANDLE* file_handle) const
+void CASCArchive::buildFileDataIDIndex(std::string const& file_index_directory)
 {
-  std::uint32_t file_data_id;
+  CASC_STORAGE_PRODUCT product {};
+  bool const has_build = CascGetStorageInfo(_handle, CascStorageProduct, &product, sizeof(product), nullptr)
+    && product.BuildNumber;
+
+  // One file per build and locale mask, clients of different builds or locales may share the directory.
+  char index_name[64];
+  std::snprintf(index_name, sizeof(index_name), "casc_file_data_ids_%u_%08x.bin", product.BuildNumber, _locale_mask);
+
+  std::string const index_path = file_index_directory.empty() || !has_build ? std::string()
+    : (fs::path(file_index_directory) / index_name).string();
+
+  if (!index_path.empty() && loadFileDataIDIndex(index_path, product.BuildNumber))
+    return;
+
+  forEachRootEntry(_handle, _locale_mask, [&](CASC_FIND_DATA const& find_data)
+  {
+    std::size_t const word = find_data.dwFileDataId >> 6;
+    if (word >= _file_data_ids.size())
+      _file_data_ids.resize(word + 1);
+
+    _file_data_ids[word] |= std::uint64_t(1) << (find_data.dwFileDataId & 63);
+  });
+
+  _file_data_ids.shrink_to_fit();
+
+  if (!index_path.empty() && !_file_data_ids.empty())
+    saveFileDataIDIndex(index_path, product.BuildNumber);
+}
+
+bool CASCArchive::loadFileDataIDIndex(std::string const& index_path, std::uint32_t build_number)
+{
+  std::ifstream stream {index_path, std::ios_base::binary | std::ios_base::in};
+
+  if (!stream)
+    return false;
 
+  char header[FileDataIDIndexHeaderSize];
+  if (!stream.read(header, sizeof(header)) || std::memcmp(header, FileDataIDIndexMagic.data(), FileDataIDIndexMagic.size()))
+    return false;
+
+  std::uint32_t fields[3];
+  std::memcpy(fields, header + FileDataIDIndexMagic.size(), sizeof(fields));
+
+  // Any update of the storage changes the build, the index is rebuilt then.
+  if (fields[0] != build_number || fields[1] != _locale_mask || !fields[2])
+    return false;
+
+  std::vector<std::uint64_t> words(fields[2]);
+  if (!stream.read(reinterpret_cast<char*>(words.data()), words.size() * sizeof(std::uint64_t)))
+    return false;
+
+  _file_data_ids = std::move(words);
+  return true;
+}
+
+void CASCArchive::saveFileDataIDIndex(std::string const& index_path, std::uint32_t build_number) const
+{
+  char header[FileDataIDIndexHeaderSize];
+  std::uint32_t const fields[3] { build_number, _locale_mask, static_cast<std::uint32_t>(_file_data_ids.size()) };
+  std::memcpy(header, FileDataIDIndexMagic.data(), FileDataIDIndexMagic.size());
+  std::memcpy(header + FileDataIDIndexMagic.size(), fields, sizeof(fields));
+
+  // The index is only a cache, failing to write it is not an error.
+  static_cast<void>(replaceFile(index_path, [&](std::ostream& stream)
+  {
+    stream.write(header, sizeof(header));
+    stream.write(reinterpret_cast<char const*>(_file_data_ids.data()), _file_data_ids.size() * sizeof(std::uint64_t));
+  }));
+}
+
+std::uint32_t CASCArchive::getFileDataID(Listfile::FileKey const& file_key) const
+{
   assert(file_key.hasFileDataID() || file_key.hasFilepath());
 
   if (file_key.hasFileDataID())
   {
     assert(file_key.fileDataID());
 
-    file_data_id = file_key.fileDataID();
-  }
-  else
-  {
-    file_data_id = _listfile->getFileDataID(file_key.filepath());
+    return file_key.fileDataID();
   }
 
+  return _listfile->getFileDataID(file_key.filepath());
+}
 
-  return CascOpenFile(_handle, CASC_FILE_DATA_ID(file_data_id), 0, 3, file_handle);
+bool CASCArchive::openFile(Listfile::FileKey const& file_key, Locale locale, HANDLE* file_handle) const
+{
+  return CascOpenFile(_handle, CASC_FILE_DATA_ID(getFileDataID(file_key)), 0, 3, file_handle);
 }
 
 bool CASCArchive::readFile(HANDLE file_handle, char* buffer, std::size_t buf_size) const
@@ -157,27 +290,177 @@ std::uint64_t CASCArchive::getFileSize(HANDLE file_handle) const
 
 bool CASCArchive::exists(Listfile::FileKey const& file_key, Locale locale) const
 {
+  std::uint32_t const file_data_id = getFileDataID(file_key);
+
+  if (!_file_data_ids.empty())
+    return file_data_id && hasFileDataID(file_data_id);
+
   HANDLE file_handle = nullptr;
-  std::uint32_t file_data_id;
 
-  assert(file_key.hasFileDataID() || file_key.hasFilepath());
+  bool status = CascOpenFile(_handle, CASC_FILE_DATA_ID(file_data_id), 0, 3, &file_handle);
+  CascCloseFile(file_handle);
+  return status;
 
-  if (file_key.hasFileDataID())
+}
+
+bool CASCArchive::readFile(Listfile::FileKey const& file_key, Locale locale, std::vector<char>& buffer) const
+{
+  HANDLE file_handle = nullptr;
+
+  if (!CascOpenFile(_handle, CASC_FILE_DATA_ID(getFileDataID(file_key)), 0, 3, &file_handle))
+    return false;
+
+  ULONGLONG file_size = 0;
+  bool status = CascGetFileSize64(file_handle, &file_size);
+
+  if (status)
   {
-    assert(file_key.fileDataID());
+    buffer.resize(file_size);
+    status = CascReadFile(file_handle, buffer.data(), static_cast<DWORD>(file_size), nullptr);
+  }
+
+  CascCloseFile(file_handle);
+  return status;
+}
+
+std::optional<std::uint64_t> CASCArchive::getFileOffset(Listfile::FileKey const& file_key, Locale locale) const
+{
+  std::optional<FileLocation> const location = locateFile(file_key, locale);
+  return location ? std::optional<std::uint64_t>(location->offset) : std::nullopt;
+}
+
+std::optional<BlizzardArchive::ContentKey> CASCArchive::getContentKey(Listfile::FileKey const& file_key, Locale locale) const
+{
+  std::optional<FileLocation> const location = locateFile(file_key, locale);
+  return location ? location->content_key : std::nullopt;
+}
+
+std::optional<BaseArchive::FileLocation> CASCArchive::locateFile(Listfile::FileKey const& file_key, Locale locale) const
+{
+  CASC_FILE_FULL_INFO info {};
+
+  if (!getFullInfo(_handle, getFileDataID(file_key), info))
+    return std::nullopt;
+
+  // StorageOffset encodes both the data archive index and the position inside it, so it sorts by physical layout.
+  FileLocation location { info.StorageOffset, ContentKey() };
+  std::memcpy(location.content_key->data(), info.CKey, location.content_key->size());
+  return location;
+}
+
+std::optional<BlizzardArchive::ContentKey> CASCArchive::getEncodingKey(Listfile::FileKey const& file_key, Locale locale) const
+{
+  CASC_FILE_FULL_INFO info {};
+
+  if (!getFullInfo(_handle, getFileDataID(file_key), info))
+    return std::nullopt;
+
+  ContentKey key;
+  std::memcpy(key.data(), info.EKey, key.size());
+  return key;
+}
+
+bool CASCArchive::forEachManifestEntry(std::function<void(ManifestEntry&&)> const& callback) const
+{
+  return forEachRootEntry(_handle, _locale_mask, [&](CASC_FIND_DATA const& find_data)
+  {
+    ManifestEntry entry;
+    entry.file_data_id = find_data.dwFileDataId;
+    entry.size = find_data.FileSize;
+    entry.hash_type = ManifestHashType::CONTENT_KEY;
+    std::memcpy(entry.hash.data(), find_data.CKey, entry.hash.size());
+
+    callback(std::move(entry));
+  });
+}
+
+BlizzardArchive::PrefetchProgress CASCArchive::prefetch(std::span<std::uint32_t const> file_data_ids
+  , PrefetchCallback const& callback
+  , unsigned concurrency) const
+{
+  using EncodingKey = std::array<BYTE, MD5_HASH_SIZE>;
 
-    file_data_id = file_key.fileDataID();
+  std::vector<std::uint32_t> ids(file_data_ids.begin(), file_data_ids.end());
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+  // Opening by file data ID only resolves the root and encoding manifests, nothing is downloaded yet.
+  std::vector<EncodingKey> keys;
+  keys.reserve(ids.size());
+
+  PrefetchProgress progress;
+
+  for (std::uint32_t file_data_id : ids)
+  {
+    CASC_FILE_FULL_INFO info {};
+
+    if (!getFullInfo(_handle, file_data_id, info))
+    {
+      ++progress.failed;
+      continue;
+    }
+
+    EncodingKey key;
+    std::memcpy(key.data(), info.EKey, key.size());
+    keys.push_back(key);
   }
-  else
+
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+  progress.total = keys.size() + progress.failed;
+
+  // Downloads take very different times, so workers take the next key instead of fixed ranges.
+  std::atomic<std::size_t> next = 0;
+  std::mutex progress_mutex;
+
+  auto worker = [&]
+  {
+    auto buffer = std::make_unique<char[]>(PrefetchChunkSize);
+
+    for (std::size_t i = next++; i < keys.size(); i = next++)
+    {
+      HANDLE file_handle = nullptr;
+      std::uint64_t bytes = 0;
+      bool status = CascOpenFile(_handle, keys[i].data(), 0, CASC_OPEN_BY_EKEY, &file_handle);
+
+      while (status)
+      {
+        DWORD read = 0;
+        status = CascReadFile(file_handle, buffer.get(), static_cast<DWORD>(PrefetchChunkSize), &read);
+
+        if (!read)
+          break;
+
+        bytes += read;
+      }
+
+      if (file_handle)
+        CascCloseFile(file_handle);
+
+      const std::lock_guard _lock(progress_mutex);
+      ++(status ? progress.completed : progress.failed);
+      progress.bytes += bytes;
+
+      if (callback)
+        callback(progress);
+    }
+  };
+
+  std::vector<std::future<void>> workers;
+  for (unsigned i = 1; i < std::max(1u, concurrency); ++i)
   {
-    file_data_id = _listfile->getFileDataID(file_key.filepath());
+    workers.push_back(std::async(std::launch::async, worker));
   }
 
+  worker();
 
-  bool status = CascOpenFile(_handle, CASC_FILE_DATA_ID(file_data_id), 0, 3, &file_handle);
-  CascCloseFile(file_handle);
-  return status;
+  for (auto& task : workers)
+  {
+    task.get();
+  }
 
+  return progress;
 }
 
 CASCArchive::~CASCArchive()
@@ -1,26 +1,89 @@
 #include <ClientData.hpp>
 #include <Exception.hpp>
+#include <FileReplace.hpp>
+#include <IOExecutor.hpp>
 #include <MPQArchive.hpp>
 #include <DirectoryArchive.hpp>
 #include <CASCArchive.hpp>
+#include <ListfileRegistry.hpp>
+#include <PathIndex.hpp>
 #include <StormLib.h>
 
+#include <algorithm>
 #include <cassert>
+#include <exception>
 #include <filesystem>
+#include <fstream>
 #include <future>
-#include <omp.h>
-#include <regex>
+#include <iterator>
+#include <latch>
+#include <stdexcept>
+#include <tuple>
 
 using namespace BlizzardArchive;
 namespace fs = std::filesystem;
 
-ClientData::ClientData(std::string const& path, ClientVersion version, Locale locale, std::string const& local_path)
+namespace
+{
+  /*
+  * Splits [0, count) into contiguous ranges and runs fn(begin, end) for each of them, on the shared I/O
+  * pool and the calling thread, rethrowing the first exception. Calls made on the pool stay inline,
+  * waiting on requests queued behind them could exhaust the workers.
+  */
+  template<typename Fn>
+  void parallelForRanges(std::size_t count, unsigned worker_count, Fn&& fn)
+  {
+    if (!count)
+      return;
+
+    IOExecutor* const executor = IOExecutor::instance();
+    std::size_t const workers = executor->isWorkerThread() ? 1
+      : std::max<std::size_t>(1, std::min<std::size_t>({ worker_count, executor->workerCount() + 1, count }));
+    std::size_t const range_size = (count + workers - 1) / workers;
+    std::size_t const range_count = (count + range_size - 1) / range_size;
+
+    std::vector<std::exception_ptr> errors(range_count);
+    auto runRange = [&](std::size_t range)
+    {
+      try
+      {
+        fn(range * range_size, std::min((range + 1) * range_size, count));
+      }
+      catch (...)
+      {
+        errors[range] = std::current_exception();
+      }
+    };
+
+    std::latch done(static_cast<std::ptrdiff_t>(range_count - 1));
+    for (std::size_t range = 1; range < range_count; ++range)
+    {
+      // Cancelled requests still run the range, everything they reference lives until done is reached.
+      auto task = [&, range] { runRange(range); done.count_down(); };
+      executor->submit(task, task);
+    }
+
+    runRange(0);
+    done.wait();
+
+    for (auto const& error : errors)
+    {
+      if (error)
+        std::rethrow_exception(error);
+    }
+  }
+}
+
+ClientData::ClientData(std::string const& path, ClientVersion version, Locale locale, std::string const& local_path
+  , std::shared_ptr<Listfile::Listfile const> listfile, bool persist_file_data_id_index)
   : _version(version)
   , _open_mode(OpenMode::LOCAL)
   , _storage_type((version > ClientVersion::MOP) ? StorageType::CASC : StorageType::MPQ)
   , _locale_mode(locale)
   , _path(path)
   , _local_path(ClientData::normalizeFilenameUnix(local_path))
+  , _persist_file_data_id_index(persist_file_data_id_index)
+  , _listfile(std::move(listfile))
 {
 
   validateLocale();
@@ -34,9 +97,12 @@ ClientData::ClientData(std::string const& path, ClientVersion version, Locale lo
     initializeCASCStorage();
     break;
   }
+
+  buildFileIndex();
 }
 
-ClientData::ClientData(std::string const& path, std::string const& cdn_cache_path, ClientVersion version, Locale locale, std::string const& local_path)
+ClientData::ClientData(std::string const& path, std::string const& cdn_cache_path, ClientVersion version, Locale locale
+  , std::string const& local_path, std::shared_ptr<Listfile::Listfile const> listfile, bool persist_file_data_id_index)
     : _version(version)
     , _open_mode(OpenMode::REMOTE)
     , _storage_type((version > ClientVersion::MOP) ? StorageType::CASC : StorageType::MPQ)
@@ -44,6 +110,8 @@ ClientData::ClientData(std::string const& path, std::string const& cdn_cache_pat
     , _path(path)
     , _local_path(ClientData::normalizeFilenameUnix(local_path))
     , _cdn_cache_path(cdn_cache_path)
+    , _persist_file_data_id_index(persist_file_data_id_index)
+    , _listfile(std::move(listfile))
 {
 
   validateLocale();
@@ -57,6 +125,8 @@ ClientData::ClientData(std::string const& path, std::string const& cdn_cache_pat
       throw Exceptions::Archive::ArchiveOpenError("MPQ storage does not support online loading.");
       break;
   }
+
+  buildFileIndex();
 }
 
 ClientData::~ClientData()
@@ -68,25 +138,142 @@ ClientData::~ClientData()
   }
 }
 
-void ClientData::loadMPQArchive(std::string const& mpq_path)
+Archive::BaseArchive* ClientData::openArchive(std::string const& mpq_path)
 {
   if (!fs::exists(mpq_path) || fs::equivalent(mpq_path, _local_path))
-    return;
+    return nullptr;
 
   if (fs::is_directory(mpq_path))
   {
-    _archives.push_back(new Archive::DirectoryArchive(mpq_path, _locale_mode, &_listfile));
+    return new Archive::DirectoryArchive(mpq_path, _locale_mode, _listfile.get());
   }
   else
   {
-    _archives.push_back(new Archive::MPQArchive(mpq_path, _locale_mode, &_listfile));
+    return new Archive::MPQArchive(mpq_path, _locale_mode, _mpq_listfile);
   }
+}
 
+void ClientData::loadMPQArchive(std::string const& mpq_path)
+{
+  if (Archive::BaseArchive* archive = openArchive(mpq_path))
+  {
+    _archives.push_back(archive);
+  }
+}
 
+namespace
+{
+  std::string toLower(std::string name)
+  {
+    std::transform(name.begin(), name.end(), name.begin(), [](char c) { return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c; });
+    return name;
+  }
+}
+
+std::unordered_map<std::string, std::string> ClientData::scanDataDirectory() const
+{
+  // Archive names are matched ignoring case, as the file system does on Windows.
+  std::unordered_map<std::string, std::string> entries;
+  std::string_view const& locale = ClientData::Locales[static_cast<int>(_locale_mode) - 1];
+
+  std::error_code ec;
+  for (auto const& entry : fs::directory_iterator(fs::path(_path) / "Data", ec))
+  {
+    std::string name = entry.path().filename().string();
+    entries.emplace(toLower(name), std::move(name));
+  }
+
+  for (auto const& entry : fs::directory_iterator(fs::path(_path) / "Data" / locale, ec))
+  {
+    std::string name = std::string(locale) + "/" + entry.path().filename().string();
+    entries.emplace(toLower(name), std::move(name));
+  }
+
+  return entries;
+}
+
+std::vector<std::string> ClientData::expandArchiveTemplate(std::string_view name_template
+  , std::unordered_map<std::string, std::string> const& data_entries) const
+{
+  std::string name = toLower(std::string(name_template));
+  std::string_view const& locale = ClientData::Locales[static_cast<int>(_locale_mode) - 1];
+
+  std::string::size_type location;
+  while ((location = name.find("{locale}")) != std::string::npos)
+  {
+    name.replace(location, 8, toLower(std::string(locale)));
+  }
+
+  // Candidates are lowercase, the names returned are the ones on disk.
+  std::vector<std::string> names;
+  auto addIfPresent = [&](std::string const& candidate)
+  {
+    auto it = data_entries.find(candidate);
+    if (it != data_entries.end())
+      names.push_back(it->second);
+  };
+
+  if ((location = name.find("{number}")) != std::string::npos)
+  {
+    name.replace(location, 8, " ");
+    for (char j = '2'; j <= '9'; j++)
+    {
+      name[location] = j;
+      addIfPresent(name);
+    }
+  }
+  else if ((location = name.find("{character}")) != std::string::npos)
+  {
+    name.replace(location, 11, " ");
+    for (char c = 'a'; c <= 'z'; c++)
+    {
+      name[location] = c;
+      addIfPresent(name);
+    }
+  }
+  else if ((location = name.find("{patch}")) != std::string::npos)
+  {
+    // Update archives are numbered by build, apply them from the oldest to the newest.
+    std::string_view prefix = std::string_view(name).substr(0, location);
+    std::string_view suffix = std::string_view(name).substr(location + 7);
+    std::vector<std::pair<unsigned long, std::string>> patches;
+
+    for (auto const& [entry, disk_name] : data_entries)
+    {
+      if (entry.size() <= prefix.size() + suffix.size() || !entry.starts_with(prefix) || !entry.ends_with(suffix))
+        continue;
+
+      std::string_view build = std::string_view(entry).substr(prefix.size(), entry.size() - prefix.size() - suffix.size());
+      if (std::all_of(build.begin(), build.end(), [](char c) { return c >= '0' && c <= '9'; }))
+      {
+        patches.emplace_back(std::stoul(std::string(build)), disk_name);
+      }
+    }
+
+    std::sort(patches.begin(), patches.end());
+    for (auto& patch : patches)
+    {
+      names.push_back(std::move(patch.second));
+    }
+  }
+  else
+  {
+    addIfPresent(name);
+  }
+
+  return names;
 }
 
 void ClientData::initializeMPQStorage()
 {
+  // Archive names are merged into the listfile as archives open, which a shared one must not see.
+  if (_listfile)
+    throw std::invalid_argument("MPQ clients can not use a shared listfile.");
+
+  auto listfile = std::make_shared<Listfile::Listfile>();
+  _mpq_listfile = listfile.get();
+  _listfile = std::move(listfile);
+
   // Handle the two main storage differently.
   //   After Cataclysm they started patching files.
   if (_version < ClientVersion::CATA)
@@ -97,25 +284,97 @@ void ClientData::initializeMPQStorage()
 
 void ClientData::initializeCASCStorage()
 {
-  _listfile.initFromCSV((fs::path(_local_path) / "listfile.csv").string());
+  // Clients of the same project share one listfile, see Listfile::ListfileRegistry.
+  if (!_listfile)
+    _listfile = Listfile::ListfileRegistry::instance().acquire(_local_path);
 
   switch (_open_mode)
   {
     case OpenMode::LOCAL:
     {
-      _archives.push_back(new Archive::CASCArchive(_path, "", _locale_mode, _open_mode, &_listfile));
+      std::string const index_directory = _persist_file_data_id_index ? _path : "";
+      _archives.push_back(new Archive::CASCArchive(_path, "", _locale_mode, _open_mode, _listfile.get(), index_directory));
       break;
     }
     case OpenMode::REMOTE:
     {
       assert(_cdn_cache_path.has_value());
-      _archives.push_back(new Archive::CASCArchive(_path, _cdn_cache_path.value(), _locale_mode, _open_mode, &_listfile));
+      std::string const index_directory = _persist_file_data_id_index ? _cdn_cache_path.value() : "";
+      _archives.push_back(new Archive::CASCArchive(_path, _cdn_cache_path.value(), _locale_mode, _open_mode, _listfile.get(), index_directory));
       break;
     }
   }
 
 }
 
+void ClientData::buildFileIndex()
+{
+  // Archive listings are independent of each other, only merging them has to follow the load order.
+  std::vector<std::future<std::pair<bool, std::vector<std::string>>>> listings;
+  listings.reserve(_archives.size());
+
+  for (auto archive : _archives)
+  {
+    listings.push_back(std::async(std::launch::async, [archive]
+    {
+      std::vector<std::string> filenames;
+      bool indexed = archive->forEachFile([&](std::string const& filename)
+      {
+        filenames.push_back(filename);
+      });
+
+      return std::make_pair(indexed, std::move(filenames));
+    }));
+  }
+
+  for (std::size_t i = 0; i < _archives.size(); ++i)
+  {
+    auto [indexed, filenames] = listings[i].get();
+
+    if (!indexed)
+    {
+      _unindexed_archives.push_back(i);
+      continue;
+    }
+
+    // Later archives override earlier ones, so plain overwriting leaves the winner in the index.
+    for (auto const& filename : filenames)
+    {
+      _file_index[Listfile::PathPool::instance().intern(filename)] = i;
+    }
+  }
+}
+
+template<typename Visitor>
+bool ClientData::visitCandidateArchives(Listfile::FileKey const& file_key, Visitor&& visitor) const
+{
+  if (!file_key.hasFilepath())
+  {
+    for (auto it = _archives.rbegin(); it != _archives.rend(); ++it)
+    {
+      if (visitor(*it))
+        return true;
+    }
+
+    return false;
+  }
+
+  auto it = _file_index.find(file_key.pathID());
+  std::size_t winner = it != _file_index.end() ? it->second : _archives.size();
+
+  // Unindexed archives loaded after the indexed winner may still override it.
+  for (auto unindexed = _unindexed_archives.rbegin(); unindexed != _unindexed_archives.rend(); ++unindexed)
+  {
+    if (winner != _archives.size() && *unindexed < winner)
+      break;
+
+    if (visitor(_archives[*unindexed]))
+      return true;
+  }
+
+  return winner != _archives.size() && visitor(_archives[winner]);
+}
+
 void ClientData::validateLocale()
 {
   switch (_storage_type)
@@ -191,53 +450,47 @@ void ClientData::validateLocale()
 
 void ClientData::initializeMPQStoragePreCata()
 {
+  // One directory scan replaces probing every expanded template on disk.
+  std::unordered_map<std::string, std::string> const data_entries = scanDataDirectory();
+
+  std::vector<std::future<Archive::BaseArchive*>> loading;
   for (auto const& filename : ClientData::PreCataArchiveNameTemplates)
   {
-    std::string mpq_path = (fs::path(_path) / "Data" / filename).string();
-
-    std::string::size_type location(std::string::npos);
-    std::string_view const& locale = ClientData::Locales[static_cast<int>(_locale_mode) - 1];
-
-    do
-    {
-      location = mpq_path.find("{locale}");
-      if (location != std::string::npos)
-      {
-        mpq_path.replace(location, 8, locale);
-      }
-    } while (location != std::string::npos);
-
-    if (mpq_path.find("{number}") != std::string::npos)
+    for (auto const& name : expandArchiveTemplate(filename, data_entries))
     {
-      location = mpq_path.find("{number}");
-      mpq_path.replace(location, 8, " ");
-      for (char j = '2'; j <= '9'; j++)
-      {
-        mpq_path.replace(location, 1, std::string(&j, 1));
-        loadMPQArchive(mpq_path);
-      }
+      std::string mpq_path = (fs::path(_path) / "Data" / name).string();
+      loading.push_back(std::async(std::launch::async, [this, mpq_path] { return openArchive(mpq_path); }));
     }
-    else if (mpq_path.find("{character}") != std::string::npos)
+  }
+
+  // Collect in template order so that _archives keeps the override priority.
+  std::exception_ptr error;
+  for (auto& archive : loading)
+  {
+    try
     {
-      location = mpq_path.find("{character}");
-      mpq_path.replace(location, 11, " ");
-      for (char c = 'a'; c <= 'z'; c++)
+      if (Archive::BaseArchive* loaded = archive.get())
       {
-        mpq_path.replace(location, 1, std::string(&c, 1));
-        loadMPQArchive(mpq_path);
+        _archives.push_back(loaded);
       }
     }
-    else
+    catch (...)
     {
-      loadMPQArchive(mpq_path);
+      if (!error)
+        error = std::current_exception();
     }
   }
+
+  if (error)
+    std::rethrow_exception(error);
 }
 
 void ClientData::initializeMPQStoragePostCata()
 {
+  std::unordered_map<std::string, std::string> const data_entries = scanDataDirectory();
+
   bool loadedPatch = false;
-  HANDLE handle;
+  Archive::MPQArchive* baseArchive = nullptr;
   auto loadOrPatchArchive = [&](const std::string& mpqPath, const std::string_view& prefix)
     {
       if (!loadedPatch)
@@ -246,92 +499,348 @@ void ClientData::initializeMPQStoragePostCata()
         if (_archives.size())
         {
           loadedPatch = true;
-          handle = ((Archive::MPQArchive*)*_archives.begin())->getHandle();
+          baseArchive = static_cast<Archive::MPQArchive*>(*_archives.begin());
         }
       }
       else
       {
-        SFileOpenPatchArchive(handle, mpqPath.c_str(), prefix.data(), 0);
+        baseArchive->openPatchArchive(mpqPath, std::string(prefix));
       }
     };
 
-  bool localeArchive;
   std::string_view const& locale = ClientData::Locales[static_cast<int>(_locale_mode) - 1];
   for (auto const& filename : ClientData::PostCataArchiveNameTemplates)
   {
-    localeArchive = false;
-    std::string mpq_path = (fs::path(_path) / "Data" / filename).string();
+    bool localeArchive = filename.find("{locale}") != std::string_view::npos;
 
-    std::string::size_type location(std::string::npos);
+    // Patches have to be applied one after another, so only discovery benefits from the scan here.
+    for (auto const& name : expandArchiveTemplate(filename, data_entries))
+    {
+      loadOrPatchArchive((fs::path(_path) / "Data" / name).string(), localeArchive ? locale : "base");
+    }
+  }
+}
 
-    do
+bool ClientData::readFileUncached(Listfile::FileKey const& file_key, std::vector<char>& buffer) const
+{
+  return visitCandidateArchives(file_key, [&](Archive::BaseArchive* archive)
+  {
+    return archive->readFile(file_key, _locale_mode, buffer);
+  });
+}
+
+bool ClientData::readFile(Listfile::FileKey const& file_key, std::vector<char>& buffer) const
+{
+  if (!_cache)
+    return readFileUncached(file_key, buffer);
+
+  SharedBuffer shared = readFileShared(file_key);
+
+  if (!shared)
+    return false;
+
+  buffer.assign(shared.data(), shared.data() + shared.size());
+  return true;
+}
+
+SharedBuffer ClientData::readFileShared(Listfile::FileKey const& file_key) const
+{
+  std::string key;
+  std::string content_key;
+
+  if (_cache)
+  {
+    key = cacheKey(file_key);
+
+    if (SharedBuffer cached = _cache->find(key))
+      return cached;
+
+    // Only misses look the content key up, the contents may be cached under another file data ID already.
+    if (std::optional<ContentKey> file_content_key = getContentKey(file_key))
     {
-      location = mpq_path.find("{locale}");
-      if (location != std::string::npos)
+      content_key.assign(reinterpret_cast<char const*>(file_content_key->data()), file_content_key->size());
+
+      if (SharedBuffer same = _cache->findContent(content_key))
       {
-        mpq_path.replace(location, 8, locale);
+        _cache->insert(key, same, content_key);
+        return same;
       }
-      localeArchive = true;
-    } while (location != std::string::npos);
+    }
+  }
+
+  SharedBuffer shared;
+  visitCandidateArchives(file_key, [&](Archive::BaseArchive* archive)
+  {
+    shared = archive->readFileShared(file_key, _locale_mode);
+    return static_cast<bool>(shared);
+  });
+
+  if (!shared)
+    return {};
+
+  if (_cache)
+  {
+    // Loose files may be written in place later, which a cached mapping would not survive.
+    if (shared.isMapped())
+      shared = SharedBuffer(std::vector<char>(shared.data(), shared.data() + shared.size()));
+
+    _cache->insert(key, shared, content_key);
+  }
+
+  return shared;
+}
+
+std::string ClientData::cacheKey(Listfile::FileKey const& file_key) const
+{
+  std::uint32_t file_data_id = file_key.fileDataID();
+
+  if (!file_data_id && _storage_type == StorageType::CASC && file_key.hasFilepath())
+  {
+    file_data_id = _listfile->getFileDataID(file_key.filepath());
+  }
+
+  // '#' never appears in normalized paths, so ids and paths can not collide.
+  return file_data_id ? "#" + std::to_string(file_data_id) : file_key.filepath();
+}
+
+void ClientData::setCacheBudget(std::size_t byte_budget)
+{
+  _cache = byte_budget ? std::make_unique<FileCache>(byte_budget) : nullptr;
+}
+
+void ClientData::refreshDirectories()
+{
+  for (auto archive : _archives)
+  {
+    if (auto directory = dynamic_cast<Archive::DirectoryArchive*>(archive))
+      directory->refresh();
+  }
+
+  if (_cache)
+    _cache->clear();
+}
+
+FileCacheStats ClientData::cacheStats() const
+{
+  return _cache ? _cache->stats() : FileCacheStats{};
+}
+
+std::vector<std::optional<std::vector<char>>> ClientData::readFiles(std::span<Listfile::FileKey const> file_keys
+  , unsigned worker_count) const
+{
+  struct BatchEntry
+  {
+    std::size_t key_index;
+    Archive::BaseArchive* archive;
+    std::uint64_t offset;
+    std::optional<ContentKey> content_key;
+  };
+
+  if (!worker_count)
+  {
+    worker_count = IOExecutor::instance()->workerCount() + 1;
+  }
 
-    if (mpq_path.find("{number}") != std::string::npos)
+  // Resolve the winning archive and the storage offset of every file.
+  std::vector<std::optional<BatchEntry>> resolved(file_keys.size());
+  parallelForRanges(file_keys.size(), worker_count, [&](std::size_t begin, std::size_t end)
+  {
+    for (std::size_t i = begin; i < end; ++i)
     {
-      location = mpq_path.find("{number}");
-      mpq_path.replace(location, 8, " ");
-      for (char j = '2'; j <= '9'; j++)
+      visitCandidateArchives(file_keys[i], [&](Archive::BaseArchive* archive)
       {
-        mpq_path.replace(location, 1, std::string(&j, 1));
-        loadOrPatchArchive(mpq_path, localeArchive ? locale : "base");
-      }
+        std::optional<Archive::BaseArchive::FileLocation> location = archive->locateFile(file_keys[i], _locale_mode);
+
+        if (location)
+        {
+          resolved[i] = BatchEntry{ i, archive, location->offset, std::move(location->content_key) };
+        }
+
+        return location.has_value();
+      });
     }
-    else if (mpq_path.find("{character}") != std::string::npos)
+  });
+
+  std::vector<BatchEntry> entries;
+  entries.reserve(file_keys.size());
+  for (auto& entry : resolved)
+  {
+    if (entry)
+      entries.push_back(entry.value());
+  }
+
+  // Identical files are read once and copied, (copy, original) pairs of key indices.
+  std::sort(entries.begin(), entries.end(), [](BatchEntry const& lhs, BatchEntry const& rhs)
+  {
+    return std::tie(lhs.archive, lhs.content_key, lhs.key_index) < std::tie(rhs.archive, rhs.content_key, rhs.key_index);
+  });
+
+  std::vector<std::pair<std::size_t, std::size_t>> duplicates;
+  std::size_t unique_count = 0;
+  for (std::size_t i = 0; i < entries.size(); ++i)
+  {
+    BatchEntry const& original = entries[unique_count ? unique_count - 1 : 0];
+
+    if (unique_count && entries[i].content_key && original.archive == entries[i].archive
+      && original.content_key == entries[i].content_key)
     {
-      location = mpq_path.find("{character}");
-      mpq_path.replace(location, 11, " ");
-      for (char c = 'a'; c <= 'z'; c++)
-      {
-        mpq_path.replace(location, 1, std::string(&c, 1));
-        loadOrPatchArchive(mpq_path, localeArchive ? locale : "base");
-      }
+      duplicates.emplace_back(entries[i].key_index, original.key_index);
+      continue;
     }
-    else
+
+    entries[unique_count++] = std::move(entries[i]);
+  }
+  entries.resize(unique_count);
+
+  // Group by archive and read each group front to back, so workers mostly see sequential I/O.
+  std::sort(entries.begin(), entries.end(), [](BatchEntry const& lhs, BatchEntry const& rhs)
+  {
+    return std::tie(lhs.archive, lhs.offset) < std::tie(rhs.archive, rhs.offset);
+  });
+
+  std::vector<std::optional<std::vector<char>>> results(file_keys.size());
+  parallelForRanges(entries.size(), worker_count, [&](std::size_t begin, std::size_t end)
+  {
+    for (std::size_t i = begin; i < end; ++i)
     {
-      loadOrPatchArchive(mpq_path, localeArchive ? locale : "base");
+      BatchEntry const& entry = entries[i];
+      std::vector<char> buffer;
+
+      if (entry.archive->readFile(file_keys[entry.key_index], _locale_mode, buffer))
+      {
+        results[entry.key_index] = std::move(buffer);
+      }
     }
+  });
+
+  for (auto const& [copy, original] : duplicates)
+  {
+    results[copy] = results[original];
   }
+
+  return results;
 }
 
-bool ClientData::readFile(Listfile::FileKey const& file_key, std::vector<char>& buffer)
+PrefetchProgress ClientData::prefetch(std::span<Listfile::FileKey const> file_keys
+  , PrefetchCallback const& callback
+  , unsigned concurrency) const
 {
-  const std::lock_guard _lock(_mutex);
+  if (_storage_type != StorageType::CASC || _open_mode != OpenMode::REMOTE)
+    return {};
 
-  HANDLE handle = nullptr;
+  std::vector<std::uint32_t> file_data_ids;
+  file_data_ids.reserve(file_keys.size());
 
-  for (auto it = _archives.rbegin(); it != _archives.rend(); ++it)
+  for (auto const& file_key : file_keys)
   {
-    if (!(*it)->openFile(file_key, _locale_mode, &handle))
-      continue;
+    file_data_ids.push_back(file_key.hasFileDataID() ? file_key.fileDataID() : _listfile->getFileDataID(file_key.filepath()));
+  }
+
+  // Remote clients open a single storage.
+  return static_cast<Archive::CASCArchive*>(_archives.front())->prefetch(file_data_ids, callback, concurrency);
+}
 
-    std::uint64_t buf_size = (*it)->getFileSize(handle);
-    buffer.resize(buf_size);
+PrefetchProgress ClientData::prefetch(Listfile::PathIndex const& index
+  , std::span<std::string_view const> prefixes
+  , PrefetchCallback const& callback
+  , unsigned concurrency) const
+{
+  std::vector<Listfile::FileKey> file_keys;
 
-    if (!(*it)->readFile(handle, buffer.data(), buf_size))
+  for (std::string_view prefix : prefixes)
+  {
+    for (auto const& entry : index.withPrefix(prefix))
     {
-      assert(false);
+      if (entry.file_data_id)
+        file_keys.emplace_back(entry.file_data_id);
     }
+  }
 
-    if (!(*it)->closeFile(handle))
+  return prefetch(file_keys, callback, concurrency);
+}
+
+Manifest ClientData::exportManifest() const
+{
+  // Archives are enumerated concurrently, merging follows the load order so later archives win.
+  std::vector<std::future<std::vector<ManifestEntry>>> listings;
+  listings.reserve(_archives.size());
+
+  for (auto archive : _archives)
+  {
+    listings.push_back(std::async(std::launch::async, [archive]
     {
-      assert(false);
-    }
+      std::vector<ManifestEntry> entries;
+      archive->forEachManifestEntry([&](ManifestEntry&& entry)
+      {
+        entries.push_back(std::move(entry));
+      });
 
-    return true;
+      return entries;
+    }));
+  }
+
+  std::vector<ManifestEntry> entries;
+  for (auto& listing : listings)
+  {
+    std::vector<ManifestEntry> archive_entries = listing.get();
+    std::move(archive_entries.begin(), archive_entries.end(), std::back_inserter(entries));
+  }
+
+  return Manifest(std::move(entries));
+}
+
+std::size_t ClientData::extractFiles(std::span<Listfile::FileKey const> file_keys
+  , unsigned worker_count
+  , std::size_t batch_size) const
+{
+  std::size_t written = 0;
+  batch_size = std::max<std::size_t>(1, batch_size);
+
+  for (std::size_t begin = 0; begin < file_keys.size(); begin += batch_size)
+  {
+    std::span<Listfile::FileKey const> const batch = file_keys.subspan(begin, std::min(batch_size, file_keys.size() - begin));
+    std::vector<std::optional<std::vector<char>>> contents = readFiles(batch, worker_count);
+
+    for (std::size_t i = 0; i < batch.size(); ++i)
+    {
+      if (!contents[i])
+        continue;
+
+      fs::path const disk_path = getDiskPath(batch[i]);
+
+      std::error_code ec;
+      fs::create_directories(disk_path.parent_path(), ec);
+
+      // Replaced rather than rewritten, the previous copy may be mapped and survives a failed write.
+      if (replaceFile(disk_path.string(), [&](std::ostream& output) { output.write(contents[i]->data(), contents[i]->size()); }))
+        ++written;
+    }
   }
 
-  return false;
+  return written;
+}
+
+std::optional<ContentKey> ClientData::getContentKey(Listfile::FileKey const& file_key) const
+{
+  if (_storage_type != StorageType::CASC)
+    return std::nullopt;
+
+  std::uint32_t const file_data_id = file_key.hasFileDataID() ? file_key.fileDataID() : _listfile->getFileDataID(file_key.filepath());
+
+  if (!file_data_id)
+    return std::nullopt;
+
+  std::optional<ContentKey> content_key;
+  visitCandidateArchives(file_key, [&](Archive::BaseArchive* archive)
+  {
+    content_key = archive->getContentKey(Listfile::FileKey(file_data_id), _locale_mode);
+    return content_key.has_value();
+  });
+
+  return content_key;
 }
 
-bool ClientData::existsOnDisk(Listfile::FileKey const& file_key)
+bool ClientData::existsOnDisk(Listfile::FileKey const& file_key) const
 {
   if (!file_key.hasFilepath())
     return false;
@@ -339,28 +848,22 @@ bool ClientData::existsOnDisk(Listfile::FileKey const& file_key)
   return fs::exists(getDiskPath(file_key));
 }
 
-bool ClientData::exists(Listfile::FileKey const& file_key)
+bool ClientData::exists(Listfile::FileKey const& file_key) const
 {
-  if (ClientData::existsOnDisk(file_key))
+  // Archive lookups are in memory, most files are found there before having to stat the disk.
+  if (visitCandidateArchives(file_key, [&](Archive::BaseArchive* archive)
   {
-    return true;
-  }
-
-  const std::lock_guard _lock(_mutex);
-
-  for (auto it = _archives.rbegin(); it != _archives.rend(); ++it)
+    return archive->exists(file_key, _locale_mode);
+  }))
   {
-    if ((*it)->exists(file_key, _locale_mode))
-      return true;
+    return true;
   }
 
-  return false;
+  return ClientData::existsOnDisk(file_key);
 }
 
-std::string ClientData::getDiskPath(Listfile::FileKey const& file_key)
+std::string ClientData::getDiskPath(Listfile::FileKey const& file_key) const
 {
-  const std::lock_guard _lock(_mutex);
-
   if (file_key.hasFilepath())
   {
     return (fs::path(_local_path) / ClientData::normalizeFilenameUnix(file_key.filepath())).string();
@@ -369,20 +872,25 @@ std::string ClientData::getDiskPath(Listfile::FileKey const& file_key)
   {
     // try deducing filepath from listfile
     assert(file_key.hasFileDataID());
-    std::string_view filepath = _listfile.getPath(file_key.fileDataID());
+    std::string_view filepath = _listfile->getPath(file_key.fileDataID());
 
     if (!filepath.empty())
     {
-      return (fs::path(_local_path) / ClientData::normalizeFilenameUnix(filepath.data())).string();
+      return (fs::path(_local_path) / ClientData::normalizeFilenameUnix(std::string(filepath))).string();
     }
     else
     {
-      return (fs::path(_local_path) / "unknown_files/" / std::to_string(file_key.fileDataID())).string();
+      return getUnknownFileDiskPath(file_key.fileDataID());
     }
   }
    
 }
 
+std::string ClientData::getUnknownFileDiskPath(std::uint32_t file_data_id) const
+{
+  return (fs::path(_local_path) / "unknown_files/" / std::to_string(file_data_id)).string();
+}
+
 std::string ClientData::normalizeFilenameUnix(std::string filename)
 {
   std::transform(filename.begin(), filename.end(), filename.begin()
@@ -396,21 +904,18 @@ std::string ClientData::normalizeFilenameUnix(std::string filename)
 
 std::string ClientData::normalizeFilenameInternal(std::string filename)
 {
-  std::transform(filename.begin(), filename.end(), filename.begin(), ::tolower);
-  std::transform(filename.begin(), filename.end(), filename.begin()
-      , [](char c)
-                 {
-                   return c == '\\' ? '/' : c;
-                 }
-  );
-
-  if (filename.ends_with(".mdx"))
+  // Lowercase and forward slashes in a single pass. ASCII only, like the paths in the archives.
+  for (char& c : filename)
   {
-    filename = std::regex_replace(filename, std::regex(".mdx"), ".m2");
+    if (c >= 'A' && c <= 'Z')
+      c += 'a' - 'A';
+    else if (c == '\\')
+      c = '/';
   }
-  else if(filename.ends_with(".mdl"))
+
+  if (filename.ends_with(".mdx") || filename.ends_with(".mdl"))
   {
-    filename = std::regex_replace(filename, std::regex(".mdl"), ".m2");
+    filename.replace(filename.size() - 4, 4, ".m2");
   }
 
   return filename;
@@ -1,5 +1,6 @@
 #include <ClientFile.hpp>
 #include <Exception.hpp>
+#include <FileReplace.hpp>
 #include <fstream>
 #include <iostream>
 #include <system_error>
@@ -12,30 +13,23 @@ ClientFile::ClientFile(Listfile::FileKey const& file_key, ClientData* client_dat
   , _eof(true)
   , _pointer(0)
   , _external(false)
+  , _client_data(client_data)
 {
+  // File data ID reads do not wait for a listfile still loading in the background. Until its name is
+  // known the file is looked up in unknown_files/, the name is resolved again on save.
+  std::string const override_path = resolveDiskPath(false)
+    ? _disk_path.string()
+    : client_data->getUnknownFileDiskPath(_file_key.fileDataID());
 
-  if (client_data->version() > ClientVersion::MOP)
-  {
-    _file_key.deduceOtherComponent(client_data->listfile());
-  }
-  
-  _disk_path = client_data->getDiskPath(_file_key);
-
-  std::ifstream input(_disk_path.string(), std::ios_base::binary | std::ios_base::in);
-  if (input.is_open())
+  // On-disk overrides are mapped, large loose files are never copied.
+  if ((_shared_buffer = SharedBuffer::mapFile(override_path)))
   {
     _external = true;
     _eof = false;
-
-    input.seekg(0, std::ios::end);
-    _buffer.resize(input.tellg());
-    input.seekg(0, std::ios::beg);
-    input.read(_buffer.data(), _buffer.size());
-    input.close();
     return;
   }
 
-  if (client_data->readFile(file_key, _buffer))
+  if ((_shared_buffer = client_data->readFileShared(file_key)))
   {
     _eof = false;
     return;
@@ -52,15 +46,97 @@ ClientFile::ClientFile(Listfile::FileKey const& file_key, ClientData* client_dat
 , _eof(true)
 , _pointer(0)
 , _external(false)
+, _client_data(client_data)
+{
+  static_cast<void>(resolveDiskPath(false));
+}
+
+bool ClientFile::resolveDiskPath(bool wait_for_listfile)
 {
-  if (client_data->version() > ClientVersion::MOP)
+  Listfile::Listfile const* listfile = _client_data->listfile();
+
+  // Naming a file data ID is the only step that has to wait for the listfile.
+  if (!wait_for_listfile && !_file_key.hasFilepath() && listfile && !listfile->isLoaded())
+    return false;
+
+  if (_client_data->version() > ClientVersion::MOP)
   {
-    _file_key.deduceOtherComponent(client_data->listfile());
+    _file_key.deduceOtherComponent(listfile);
   }
 
-  _disk_path = client_data->getDiskPath(_file_key);
+  _disk_path = _client_data->getDiskPath(_file_key);
+  return true;
+}
+
+std::future<std::unique_ptr<ClientFile>> ClientFile::loadAsync(Listfile::FileKey const& file_key
+  , ClientData* client_data
+  , std::stop_token stop_token
+  , IOExecutor* executor)
+{
+  auto promise = std::make_shared<std::promise<std::unique_ptr<ClientFile>>>();
+  std::future<std::unique_ptr<ClientFile>> future = promise->get_future();
+
+  executor->submit(
+    [promise, file_key, client_data]
+    {
+      try
+      {
+        promise->set_value(std::make_unique<ClientFile>(file_key, client_data));
+      }
+      catch (...)
+      {
+        promise->set_exception(std::current_exception());
+      }
+    },
+    [promise]
+    {
+      promise->set_exception(std::make_exception_ptr(Exceptions::OperationCancelledError()));
+    },
+    std::move(stop_token));
+
+  return future;
 }
 
+ClientFile::LoadAwaitable ClientFile::load(Listfile::FileKey const& file_key
+  , ClientData* client_data
+  , std::stop_token stop_token
+  , IOExecutor* executor)
+{
+  return LoadAwaitable(file_key, client_data, std::move(stop_token), executor);
+}
+
+void ClientFile::LoadAwaitable::await_suspend(std::coroutine_handle<> handle)
+{
+  // The awaitable lives in the suspended coroutine frame, so it is safe to fill it from the worker.
+  _executor->submit(
+    [this, handle]
+    {
+      try
+      {
+        _result = std::make_unique<ClientFile>(_file_key, _client_data);
+      }
+      catch (...)
+      {
+        _error = std::current_exception();
+      }
+
+      handle.resume();
+    },
+    [this, handle]
+    {
+      _error = std::make_exception_ptr(Exceptions::OperationCancelledError());
+      handle.resume();
+    },
+    _stop_token);
+}
+
+std::unique_ptr<ClientFile> ClientFile::LoadAwaitable::await_resume()
+{
+  if (_error)
+    std::rethrow_exception(_error);
+
+  return std::move(_result);
+}
 
 std::size_t ClientFile::read(void* dest, size_t bytes)
 {
@@ -68,12 +144,12 @@ std::size_t ClientFile::read(void* dest, size_t bytes)
     return 0;
 
   size_t rpos = _pointer + bytes;
-  if (rpos > _buffer.size()) {
-    bytes = _buffer.size() - _pointer;
+  if (rpos > size()) {
+    bytes = size() - _pointer;
     _eof = true;
   }
 
-  std::memcpy(dest, &(_buffer[_pointer]), bytes);
+  std::memcpy(dest, data() + _pointer, bytes);
 
   _pointer = rpos;
 
@@ -88,13 +164,13 @@ bool ClientFile::isEof() const
 void ClientFile::seek(std::size_t offset)
 {
   _pointer = offset;
-  _eof = (_pointer >= _buffer.size());
+  _eof = (_pointer >= size());
 }
 
 void ClientFile::seekRelative(std::size_t offset)
 {
   _pointer += offset;
-  _eof = (_pointer >= _buffer.size());
+  _eof = (_pointer >= size());
 }
 
 void ClientFile::close()
@@ -104,7 +180,7 @@ void ClientFile::close()
 
 std::size_t ClientFile::getSize() const
 {
-  return _buffer.size();
+  return size();
 }
 
 std::size_t ClientFile::getPos() const
@@ -114,17 +190,69 @@ std::size_t ClientFile::getPos() const
 
 char const* ClientFile::getBuffer() const
 {
-  return _buffer.data();
+  return data();
 }
 
 char const* ClientFile::getPointer() const
 {
-  return _buffer.data() + _pointer;
+  return data() + _pointer;
+}
+
+void ClientFile::setBuffer(std::vector<char> const& vec)
+{
+  _buffer = vec;
+  _private = true;
+  _shared_buffer = {};
+}
+
+void ClientFile::setBuffer(std::vector<char>&& vec)
+{
+  _buffer = std::move(vec);
+  _private = true;
+  _shared_buffer = {};
+}
+
+void ClientFile::setBuffer(SharedBuffer const& buffer)
+{
+  _shared_buffer = buffer;
+  _private = false;
+  _buffer.clear();
+}
+
+std::vector<char>& ClientFile::getWritableBuffer()
+{
+  if (!_private)
+  {
+    _buffer.assign(_shared_buffer.data(), _shared_buffer.data() + _shared_buffer.size());
+    _private = true;
+    _shared_buffer = {};
+  }
+
+  return _buffer;
+}
+
+void ClientFile::write(void const* src, std::size_t bytes)
+{
+  std::vector<char>& buffer = getWritableBuffer();
+
+  if (_pointer + bytes > buffer.size())
+  {
+    buffer.resize(_pointer + bytes);
+  }
+
+  std::memcpy(buffer.data() + _pointer, src, bytes);
+  _pointer += bytes;
+  _eof = (_pointer >= buffer.size());
 }
 
 void ClientFile::save()
 {
 
+  if (_disk_path.empty())
+  {
+    static_cast<void>(resolveDiskPath(true));
+  }
+
   std::cout << "Saving file to: " << _disk_path << std::endl;
 
   auto const directory_name(_disk_path.parent_path());
@@ -136,18 +264,19 @@ void ClientFile::save()
     std::cout << "Error: Creating directory \"" << directory_name << "\" failed: " << ec << ". Saving is highly likely to fail." << std::endl;
   }
 
-  std::ofstream output(_disk_path.string(), std::ios_base::binary | std::ios_base::out);
-  if (output.is_open())
+  // Loaded disk overrides may be a mapping of _disk_path itself, which must not be read while the file is replaced.
+  if (_external && !_private)
   {
-    output.write(_buffer.data(), _buffer.size());
-    output.close();
-
-    _external = true;
+    static_cast<void>(getWritableBuffer());
   }
-  else
-  {
 
+  // Written next to the destination and renamed over it, other readers mapping the file keep the old contents.
+  // A failed write leaves the previous file in place.
+  if (!replaceFile(_disk_path.string(), [&](std::ostream& output) { output.write(data(), size()); }))
+  {
     std::cout << "Error saving file to: " << _disk_path << std::endl;
+    return;
   }
-  
+
+  _external = true;
 }
\ No newline at end of file
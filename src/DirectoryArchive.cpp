@@ -1,46 +1,157 @@
 
 #include <DirectoryArchive.hpp>
 #include <filesystem>
+#include <algorithm>
 #include <cassert>
+#include <thread>
 
 namespace fs = std::filesystem;
 using namespace BlizzardArchive::Archive;
 using namespace BlizzardArchive::Listfile;
 
-DirectoryArchive::DirectoryArchive(std::string const& path, Locale locale, Listfile::Listfile* listfile)
+DirectoryArchive::DirectoryArchive(std::string const& path, Locale locale, Listfile::Listfile const* listfile)
 : BaseArchive(path, locale, listfile)
 {
+  scanDirectory("");
+}
+
+void DirectoryArchive::scanDirectory(std::string const& relative_path)
+{
+  fs::path const root(_path);
+  fs::path const directory_path = root / relative_path;
+
+  std::error_code ec;
+  DirectoryState& state = _directories[relative_path];
+  state.last_write_time = fs::last_write_time(directory_path, ec);
+
+  for (auto const& entry : fs::directory_iterator(directory_path, ec))
+  {
+    std::string entry_path = entry.path().lexically_relative(root).generic_string();
+
+    if (entry.is_directory(ec))
+    {
+      state.subdirectories.push_back(entry_path);
+
+      if (!_directories.contains(entry_path))
+        scanDirectory(entry_path);
+    }
+    else
+    {
+      std::uint32_t key = PathPool::instance().intern(ClientData::normalizeFilenameInternal(entry_path));
+      _index[key] = std::move(entry_path);
+      state.files.push_back(key);
+    }
+  }
+}
+
+void DirectoryArchive::forgetDirectory(std::string const& relative_path)
+{
+  auto it = _directories.find(relative_path);
 
+  if (it == _directories.end())
+    return;
+
+  DirectoryState state = std::move(it->second);
+  _directories.erase(it);
+
+  for (auto const& key : state.files)
+  {
+    _index.erase(key);
+  }
+
+  for (auto const& subdirectory : state.subdirectories)
+  {
+    forgetDirectory(subdirectory);
+  }
+}
+
+void DirectoryArchive::refresh()
+{
+  const std::unique_lock _lock(_index_mutex);
+
+  std::vector<std::string> changed;
+  for (auto const& [relative_path, state] : _directories)
+  {
+    std::error_code ec;
+    fs::file_time_type last_write_time = fs::last_write_time(fs::path(_path) / relative_path, ec);
+
+    // Added or removed entries update the modification time of their parent directory only.
+    if (ec || last_write_time != state.last_write_time)
+      changed.push_back(relative_path);
+  }
+
+  for (auto const& relative_path : changed)
+  {
+    if (!_directories.contains(relative_path))
+      continue;
+
+    // Rescanning drops removed subtrees and picks up new ones, unchanged subdirectories are kept.
+    DirectoryState& state = _directories[relative_path];
+    for (auto const& key : state.files)
+    {
+      _index.erase(key);
+    }
+
+    std::vector<std::string> subdirectories = std::move(state.subdirectories);
+    state.files.clear();
+    state.subdirectories.clear();
+
+    std::error_code ec;
+    if (!fs::is_directory(fs::path(_path) / relative_path, ec))
+    {
+      for (auto const& subdirectory : subdirectories)
+      {
+        forgetDirectory(subdirectory);
+      }
+
+      forgetDirectory(relative_path);
+      continue;
+    }
+
+    scanDirectory(relative_path);
+
+    std::vector<std::string> const& current = _directories[relative_path].subdirectories;
+    for (auto const& subdirectory : subdirectories)
+    {
+      if (std::find(current.begin(), current.end(), subdirectory) == current.end())
+        forgetDirectory(subdirectory);
+    }
+  }
 }
 
 std::string DirectoryArchive::getNormalizedFilepath(Listfile::FileKey const& file_key) const
 {
-  fs::path local_path;
+  std::uint32_t key;
 
   if (file_key.hasFilepath())
   {
-    local_path = fs::path(_path) / ClientData::normalizeFilenameUnix(file_key.filepath());
+    key = file_key.pathID();
   }
   else
   {
     // try deducing filepath from listfile
-    assert(file_key.hasFileDataID());
+    if (!file_key.hasFileDataID())
+      return "";
+
     std::string_view filepath = _listfile->getPath(file_key.fileDataID());
 
-    if (!filepath.empty())
-    {
-      local_path =  fs::path(_path) / ClientData::normalizeFilenameUnix(filepath.data());
-    }
-    else
-    {
+    if (filepath.empty())
+      return "";
+
+    // A path never seen before can not be in the index either.
+    key = PathPool::instance().find(ClientData::normalizeFilenameInternal(std::string(filepath)));
+
+    if (key == PathPool::NotFound)
       return "";
-    }
   }
 
-  if (!fs::exists(local_path))
+  const std::shared_lock _lock(_index_mutex);
+
+  auto it = _index.find(key);
+  if (it == _index.end())
     return "";
 
-  return std::move(local_path.string());
+  return (fs::path(_path) / it->second).string();
 }
 
 bool DirectoryArchive::openFile(FileKey const& file_key, Locale locale, HANDLE* file_handle) const
@@ -50,70 +161,179 @@ bool DirectoryArchive::openFile(FileKey const& file_key, Locale locale, HANDLE*
   if (file_path.empty())
     return false;
 
-  HANDLE handle = reinterpret_cast<void*>(static_cast<std::uintptr_t>(OpenFilesManager::instance()->openFiles().size()));
+  *file_handle = _open_files.open(file_path);
+  return *file_handle != nullptr;
+}
 
-  std::ifstream stream {file_path, std::ios_base::binary | std::ios_base::in};
+bool DirectoryArchive::readFile(HANDLE file_handle, char* buffer, std::size_t buf_size) const
+{
+  std::ifstream* stream = _open_files.get(file_handle);
 
-  if (!stream.is_open())
+  if (!stream)
     return false;
 
-  OpenFilesManager::instance()->openFiles().insert(std::pair<HANDLE, std::ifstream>{handle,
-    std::move(stream)});
+  stream->clear();
+  stream->seekg(0, std::ios::beg);
+  stream->read(buffer, buf_size);
 
-  return true;
+  return !stream->fail();
 }
 
-bool DirectoryArchive::readFile(HANDLE file_handle, char* buffer, std::size_t buf_size) const
+bool DirectoryArchive::closeFile(HANDLE file_handle) const
 {
-  std::ifstream& stream = OpenFilesManager::instance()->openFiles()[file_handle];
-  stream.seekg(0, std::ios::beg);
-  stream.read(buffer, buf_size);
+  return _open_files.close(file_handle);
+}
 
-  return true;
+
+std::uint64_t DirectoryArchive::getFileSize(HANDLE file_handle) const
+{
+  std::ifstream* stream = _open_files.get(file_handle);
+
+  if (!stream)
+    return 0;
+
+  stream->seekg(0, std::ios::end);
+  return stream->tellg();
 }
 
-bool DirectoryArchive::closeFile(HANDLE file_handle) const
+bool DirectoryArchive::exists(Listfile::FileKey const& file_key, Locale locale) const
 {
-  auto& open_files = OpenFilesManager::instance()->openFiles();
-  auto it = open_files.find(file_handle);
+  std::string file_path = getNormalizedFilepath(file_key);
 
-  if (it == open_files.end())
+  if (file_path.empty())
     return false;
 
-  std::ifstream& stream = it->second;
-  stream.close();
-  open_files.erase(it);
   return true;
 }
 
-
-std::uint64_t DirectoryArchive::getFileSize(HANDLE file_handle) const
+bool DirectoryArchive::readFile(Listfile::FileKey const& file_key, Locale locale, std::vector<char>& buffer) const
 {
-  std::ifstream& stream = OpenFilesManager::instance()->openFiles()[file_handle];
+  std::string file_path = getNormalizedFilepath(file_key);
+
+  if (file_path.empty())
+    return false;
+
+  // Uses a stream local to the call, so concurrent reads do not touch the shared open files table.
+  std::ifstream stream {file_path, std::ios_base::binary | std::ios_base::in};
+
+  if (!stream.is_open())
+    return false;
+
   stream.seekg(0, std::ios::end);
-  return stream.tellg();
+  buffer.resize(stream.tellg());
+  stream.seekg(0, std::ios::beg);
+  stream.read(buffer.data(), buffer.size());
+
+  return !stream.fail();
 }
 
-bool DirectoryArchive::exists(Listfile::FileKey const& file_key, Locale locale) const
+BlizzardArchive::SharedBuffer DirectoryArchive::readFileShared(Listfile::FileKey const& file_key, Locale locale) const
 {
   std::string file_path = getNormalizedFilepath(file_key);
 
   if (file_path.empty())
-    return false;
+    return {};
 
-  return true;
+  return SharedBuffer::mapFile(file_path);
 }
 
 DirectoryArchive::~DirectoryArchive()
 {
   // safety check to release fs descriptors in case of exception or anything
-  auto& open_files = OpenFilesManager::instance()->openFiles();
+  _open_files.closeAll();
+}
+
+HANDLE OpenFilesTable::open(std::string const& path)
+{
+  std::ifstream stream {path, std::ios_base::binary | std::ios_base::in};
+
+  if (!stream.is_open())
+    return nullptr;
+
+  std::uintptr_t const shard_index = std::hash<std::thread::id>{}(std::this_thread::get_id()) & ShardMask;
+  Shard& shard = _shards[shard_index];
+
+  const std::lock_guard _lock(shard.mutex);
 
-  for (auto& file : open_files)
+  std::uint32_t slot_index;
+  if (!shard.free_slots.empty())
   {
-    file.second.close();
+    slot_index = shard.free_slots.back();
+    shard.free_slots.pop_back();
   }
+  else
+  {
+    if (shard.slots.size() >= SlotMask)
+      return nullptr;
+
+    slot_index = static_cast<std::uint32_t>(shard.slots.size());
+    shard.slots.emplace_back();
+  }
+
+  Slot& slot = shard.slots[slot_index];
+  slot.stream = std::move(stream);
+  slot.used = true;
 
-  open_files.clear();
+  return reinterpret_cast<HANDLE>((slot.generation << GenerationShift)
+    | (shard_index << SlotBits)
+    | (slot_index + 1));
 }
 
+std::ifstream* OpenFilesTable::get(HANDLE handle)
+{
+  std::uintptr_t const value = reinterpret_cast<std::uintptr_t>(handle);
+  std::uintptr_t const slot_index = (value & SlotMask) - 1;
+  Shard& shard = _shards[(value >> SlotBits) & ShardMask];
+
+  const std::lock_guard _lock(shard.mutex);
+
+  if (!(value & SlotMask) || slot_index >= shard.slots.size())
+    return nullptr;
+
+  Slot& slot = shard.slots[slot_index];
+
+  if (!slot.used || slot.generation != (value >> GenerationShift))
+    return nullptr;
+
+  return &slot.stream;
+}
+
+bool OpenFilesTable::close(HANDLE handle)
+{
+  std::uintptr_t const value = reinterpret_cast<std::uintptr_t>(handle);
+  std::uintptr_t const slot_index = (value & SlotMask) - 1;
+  Shard& shard = _shards[(value >> SlotBits) & ShardMask];
+
+  const std::lock_guard _lock(shard.mutex);
+
+  if (!(value & SlotMask) || slot_index >= shard.slots.size())
+    return false;
+
+  Slot& slot = shard.slots[slot_index];
+
+  if (!slot.used || slot.generation != (value >> GenerationShift))
+    return false;
+
+  slot.stream.close();
+  slot.used = false;
+  slot.generation = (slot.generation + 1) & GenerationMask;
+  shard.free_slots.push_back(static_cast<std::uint32_t>(slot_index));
+
+  return true;
+}
+
+void OpenFilesTable::closeAll()
+{
+  for (Shard& shard : _shards)
+  {
+    const std::lock_guard _lock(shard.mutex);
+
+    for (Slot& slot : shard.slots)
+    {
+      slot.stream.close();
+    }
+
+    shard.slots.clear();
+    shard.free_slots.clear();
+  }
+}
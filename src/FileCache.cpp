@@ -0,0 +1,123 @@
+#include <FileCache.hpp>
+
+using namespace BlizzardArchive;
+
+FileCache::FileCache(std::size_t byte_budget)
+  : _byte_budget(byte_budget)
+{
+}
+
+SharedBuffer FileCache::find(std::string const& key)
+{
+  const std::lock_guard _lock(_mutex);
+
+  auto it = _entries.find(key);
+  if (it == _entries.end())
+  {
+    _misses++;
+    return {};
+  }
+
+  _hits++;
+  EntryList::iterator entry = it->second;
+
+  if (entry->segment == Segment::PROTECTED)
+  {
+    _protected.splice(_protected.begin(), _protected, entry);
+    return entry->buffer;
+  }
+
+  // Second hit, promote to the protected segment.
+  entry->segment = Segment::PROTECTED;
+  _probation_bytes -= entry->buffer.size();
+  _protected_bytes += entry->buffer.size();
+  _protected.splice(_protected.begin(), _probation, entry);
+
+  // Demote the least recently used protected entries back to probation if the segment overflows.
+  std::size_t const protected_budget = static_cast<std::size_t>(_byte_budget * ProtectedShare);
+  while (_protected_bytes > protected_budget && _protected.size() > 1)
+  {
+    EntryList::iterator demoted = std::prev(_protected.end());
+    demoted->segment = Segment::PROBATION;
+    _protected_bytes -= demoted->buffer.size();
+    _probation_bytes += demoted->buffer.size();
+    _probation.splice(_probation.begin(), _protected, demoted);
+  }
+
+  return entry->buffer;
+}
+
+SharedBuffer FileCache::findContent(std::string const& content_key)
+{
+  const std::lock_guard _lock(_mutex);
+
+  auto it = _contents.find(content_key);
+  return it != _contents.end() ? it->second->buffer : SharedBuffer();
+}
+
+void FileCache::insert(std::string const& key, SharedBuffer const& buffer, std::string const& content_key)
+{
+  if (buffer.size() > _byte_budget)
+    return;
+
+  const std::lock_guard _lock(_mutex);
+
+  if (_entries.contains(key))
+    return;
+
+  _probation.push_front(Entry{ key, buffer, Segment::PROBATION, content_key });
+  _entries[key] = _probation.begin();
+
+  if (!content_key.empty())
+    _contents[content_key] = _probation.begin();
+  _probation_bytes += buffer.size();
+  _insertions++;
+
+  evict();
+}
+
+void FileCache::evict()
+{
+  while (_probation_bytes + _protected_bytes > _byte_budget)
+  {
+    EntryList& victims = _probation.empty() ? _protected : _probation;
+    EntryList::iterator victim = std::prev(victims.end());
+
+    (victim->segment == Segment::PROBATION ? _probation_bytes : _protected_bytes) -= victim->buffer.size();
+    _entries.erase(victim->key);
+
+    auto content = victim->content_key.empty() ? _contents.end() : _contents.find(victim->content_key);
+    if (content != _contents.end() && content->second->key == victim->key)
+      _contents.erase(content);
+
+    victims.erase(victim);
+    _evictions++;
+  }
+}
+
+void FileCache::clear()
+{
+  const std::lock_guard _lock(_mutex);
+
+  _entries.clear();
+  _contents.clear();
+  _probation.clear();
+  _protected.clear();
+  _probation_bytes = 0;
+  _protected_bytes = 0;
+}
+
+FileCacheStats FileCache::stats() const
+{
+  const std::lock_guard _lock(_mutex);
+
+  FileCacheStats stats;
+  stats.hits = _hits;
+  stats.misses = _misses;
+  stats.insertions = _insertions;
+  stats.evictions = _evictions;
+  stats.entries = _entries.size();
+  stats.bytes = _probation_bytes + _protected_bytes;
+  stats.byte_budget = _byte_budget;
+  return stats;
+}
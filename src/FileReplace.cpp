@@ -0,0 +1,40 @@
+#include <FileReplace.hpp>
+#include <filesystem>
+#include <fstream>
+
+using namespace BlizzardArchive;
+namespace fs = std::filesystem;
+
+bool BlizzardArchive::replaceFile(std::string const& path, std::function<void(std::ostream&)> const& write)
+{
+  std::string const temporary_path = path + ".tmp";
+  std::error_code ec;
+
+  {
+    std::ofstream stream {temporary_path, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc};
+
+    if (!stream.is_open())
+      return false;
+
+    write(stream);
+
+    // Closing flushes, a full disk may only show up here.
+    stream.close();
+
+    if (!stream)
+    {
+      fs::remove(temporary_path, ec);
+      return false;
+    }
+  }
+
+  fs::rename(temporary_path, path, ec);
+
+  if (ec)
+  {
+    fs::remove(temporary_path, ec);
+    return false;
+  }
+
+  return true;
+}
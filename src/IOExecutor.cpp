@@ -0,0 +1,94 @@
+#include <IOExecutor.hpp>
+
+#include <algorithm>
+
+using namespace BlizzardArchive;
+
+namespace
+{
+  thread_local IOExecutor const* CurrentExecutor = nullptr;
+}
+
+IOExecutor::IOExecutor(unsigned worker_count)
+{
+  if (!worker_count)
+  {
+    worker_count = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  _workers.reserve(worker_count);
+  for (unsigned i = 0; i < worker_count; ++i)
+  {
+    _workers.emplace_back([this](std::stop_token stop_token) { workerLoop(stop_token); });
+  }
+}
+
+IOExecutor::~IOExecutor()
+{
+  cancelPending();
+
+  for (auto& worker : _workers)
+  {
+    worker.request_stop();
+  }
+
+  // Workers drain the cancelled requests before they exit, so every pending caller is notified.
+  _condition.notify_all();
+  _workers.clear();
+}
+
+void IOExecutor::submit(std::function<void()> work, std::function<void()> on_cancel, std::stop_token stop_token)
+{
+  {
+    const std::lock_guard _lock(_mutex);
+    _requests.push_back(Request{ std::move(work), std::move(on_cancel), std::move(stop_token) });
+  }
+
+  _condition.notify_one();
+}
+
+void IOExecutor::cancelPending()
+{
+  const std::lock_guard _lock(_mutex);
+
+  for (auto& request : _requests)
+  {
+    request.cancelled = true;
+  }
+}
+
+bool IOExecutor::isWorkerThread() const
+{
+  return CurrentExecutor == this;
+}
+
+void IOExecutor::workerLoop(std::stop_token stop_token)
+{
+  CurrentExecutor = this;
+
+  while (true)
+  {
+    Request request;
+
+    {
+      std::unique_lock lock(_mutex);
+      _condition.wait(lock, stop_token, [this] { return !_requests.empty(); });
+
+      if (_requests.empty())
+        return;
+
+      request = std::move(_requests.front());
+      _requests.pop_front();
+    }
+
+    if (request.cancelled || request.stop_token.stop_requested())
+    {
+      if (request.on_cancel)
+        request.on_cancel();
+    }
+    else
+    {
+      request.work();
+    }
+  }
+}
@@ -3,25 +3,75 @@
 #include <ClientData.hpp>
 #include <fstream>
 #include <sstream>
+#include <ListfileKernels.hpp>
+#include <algorithm>
+#include <charconv>
 #include <cstdint>
-#include <intrin.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <stdexcept>
+#include <thread>
 
 using namespace BlizzardArchive::Listfile;
 
+namespace
+{
+  struct CSVEntry
+  {
+    std::uint32_t file_data_id;
+    std::string_view path;
+  };
+
+  // Normalizes [begin, end) and parses its "id;path" lines. The chunk has to start at the beginning of a line.
+  void parseCSVChunk(char* begin, char* end, std::vector<CSVEntry>& entries)
+  {
+    Kernels::normalizeText(begin, end - begin);
+    entries.reserve(Kernels::countByte(begin, end - begin, '\0') + 1);
+
+    char* current = begin;
+    while (current < end)
+    {
+      char* separator = Kernels::findEitherByte(current, end, ';', '\0');
+
+      if (separator == end || *separator != ';')
+      {
+        // Empty or malformed line.
+        current = separator + 1;
+        continue;
+      }
+
+      char* lineEnd = Kernels::findByte(separator + 1, end, '\0');
+
+      std::uint32_t uid;
+      if (std::from_chars(current, separator, uid).ec == std::errc())
+      {
+        entries.push_back({ uid, std::string_view(separator + 1, lineEnd - separator - 1) });
+      }
+
+      current = lineEnd + 1;
+    }
+  }
+}
+
 FileKey::FileKey()
 : _file_data_id(0)
-, _file_path("")
+, _path_id(PathPool::EmptyPath)
 {
 }
 
 FileKey::FileKey(std::string const& filepath, std::uint32_t file_data_id)
 : _file_data_id(file_data_id)
-, _file_path(ClientData::normalizeFilenameInternal(filepath))
-{}
+{
+  setFilepath(ClientData::normalizeFilenameInternal(filepath));
+}
 
-FileKey::FileKey(std::string const& filepath, Listfile* listfile)
-  : _file_path(ClientData::normalizeFilenameInternal(filepath))
+FileKey::FileKey(std::string const& filepath, Listfile const* listfile)
 {
+  setFilepath(ClientData::normalizeFilenameInternal(filepath));
+
   if (listfile)
   {
     deduceOtherComponent(listfile);
@@ -29,9 +79,10 @@ FileKey::FileKey(std::string const& filepath, Listfile* listfile)
 
 }
 
-FileKey::FileKey(const char* filepath, Listfile* listfile)
-: _file_path(ClientData::normalizeFilenameInternal(filepath))
+FileKey::FileKey(const char* filepath, Listfile const* listfile)
 {
+  setFilepath(ClientData::normalizeFilenameInternal(filepath));
+
   if (listfile)
   {
     deduceOtherComponent(listfile);
@@ -39,12 +90,20 @@ FileKey::FileKey(const char* filepath, Listfile* listfile)
 }
 
 FileKey::FileKey(const char* filepath, std::uint32_t file_data_id)
-  : _file_path(ClientData::normalizeFilenameInternal(filepath))
-  , _file_data_id(file_data_id)
-{}
+  : _file_data_id(file_data_id)
+{
+  setFilepath(ClientData::normalizeFilenameInternal(filepath));
+}
+
+void FileKey::setFilepath(std::string const& path)
+{
+  // Looked up only, so probing arbitrary names does not grow the pool.
+  _path_id = PathPool::instance().find(path);
+  _unpooled_path = _path_id == PathPool::NotFound ? std::make_shared<std::string const>(path) : nullptr;
+}
 
 
-FileKey::FileKey(std::uint32_t file_data_id, Listfile* listfile)
+FileKey::FileKey(std::uint32_t file_data_id, Listfile const* listfile)
   : _file_data_id(file_data_id)
 {
   if (listfile)
@@ -53,10 +112,18 @@ FileKey::FileKey(std::uint32_t file_data_id, Listfile* listfile)
   }
 }
 
-void Listfile::initFromCSV(std::string const& listfile_path)
+void Listfile::initFromCSV(std::string const& listfile_path, unsigned worker_count)
+{
+  waitUntilLoaded();
+  parseCSV(listfile_path, worker_count);
+}
+
+void Listfile::parseCSV(std::string const& listfile_path, unsigned worker_count)
 {
   // If listfile is already allocated, free it.
-  if (_listfile) free(_listfile);
+  releaseCSV();
+  _binary = {};
+  _compact = {};
 
   // Open the listfile for reading.
   FILE* file = fopen(listfile_path.c_str(), "rb");
@@ -69,188 +136,358 @@ void Listfile::initFromCSV(std::string const& listfile_path)
 
   // Get size, and allocate memory and read contents.
   fseek(file, 0, SEEK_END);
-  long fileSize = ftell(file);
+  long const length = ftell(file);
   fseek(file, 0, SEEK_SET);
 
-  _listfile = (char*)malloc((size_t)ceil((float)fileSize / sizeof(__m128i)) * sizeof(__m128i));
+  if (length < 0)
+  {
+    fclose(file);
+    throw std::runtime_error("Failed to read listfile contents.");
+  }
+
+  std::size_t const fileSize = static_cast<std::size_t>(length);
+
+  // One extra byte terminates the last line even if the file does not end with a newline.
+  _listfile = (char*)malloc(fileSize + 1);
 
   if (!_listfile)
   {
-    throw std::exception("Failed to allocate listfile.");
+    fclose(file);
+    throw std::runtime_error("Failed to allocate listfile.");
     return;
   }
 
   if (fread(_listfile, 1, fileSize, file) != fileSize)
   {
-    throw std::exception("Failed to read listfile contents.");
+    fclose(file);
+    throw std::runtime_error("Failed to read listfile contents.");
     return;
   }
 
-  // Quickly cleanup the contents for processing.
-  static const __m128i mmSlashs = _mm_set1_epi8('\\');
-  static const __m128i mmReturns = _mm_set1_epi8('\r');
-  static const __m128i mmNewline = _mm_set1_epi8('\n');
-  static const __m128i mmUpper = _mm_set1_epi8('Z');
-  static const __m128i mmLower = _mm_set1_epi8('A');
-  static const __m128i mmDiff = _mm_set1_epi8('a' - 'A');
-  __m128i mmChars;
-  __m128i mmMask;
-  char* start = _listfile;
+  fclose(file);
+  _listfile[fileSize] = '\0';
+  _listfile_size = fileSize + 1;
+
   char* end = _listfile + fileSize;
-  for (; start < end; start += sizeof(__m128i))
-  {
-    // Load chars into 128bit value.
-    mmChars = _mm_loadu_epi8(start);
-
-    // Check for uppercase
-    // Set mask to 1
-    // Anything less than lower should be 0
-    // Anything more than upper should be 0
-    mmMask = _mm_cmpeq_epi8(
-      _mm_cmpgt_epi8(mmLower, mmChars),
-      _mm_cmpgt_epi8(mmChars, mmUpper)
-    );
-    mmChars = _mm_blendv_epi8(mmChars, _mm_adds_epi8(mmChars, mmDiff), mmMask);
-
-    // Check for backslashes.
-    mmMask = _mm_cmpeq_epi8(mmChars, mmSlashs);
-    mmChars = _mm_blendv_epi8(mmChars, _mm_set1_epi8('/'), mmMask);
-
-    // Check for \r,\n and replace with null.
-    mmMask = _mm_cmpeq_epi8(mmChars, mmReturns);
-    mmChars = _mm_blendv_epi8(mmChars, _mm_set1_epi8('\0'), mmMask);
-    mmMask = _mm_cmpeq_epi8(mmChars, mmNewline);
-    mmChars = _mm_blendv_epi8(mmChars, _mm_set1_epi8('\0'), mmMask);
-
-    // Load 128bit value into chars.
-    _mm_storeu_epi8(start, mmChars);
+
+  // Split the buffer at line boundaries, one chunk per worker. Small listfiles are not worth the threads.
+  std::size_t const workers = worker_count ? worker_count
+    : fileSize < ParallelParseThreshold ? 1 : std::max(1u, std::thread::hardware_concurrency());
+
+  std::vector<char*> bounds { _listfile };
+  for (std::size_t i = 1; i < workers; ++i)
+  {
+    char* bound = Kernels::findByte(std::max(bounds.back(), _listfile + fileSize * i / workers), end, '\n');
+    bounds.push_back(bound < end ? bound + 1 : end);
+  }
+  bounds.push_back(end);
+
+  // Cleanup and parse every chunk on its own thread.
+  std::vector<std::vector<CSVEntry>> chunks(workers);
+  std::vector<std::future<void>> tasks;
+  for (std::size_t i = 0; i < workers; ++i)
+  {
+    tasks.push_back(std::async(std::launch::async, [&, i]
+    {
+      parseCSVChunk(bounds[i], bounds[i + 1], chunks[i]);
+    }));
+  }
+
+  std::size_t lineCount = 0;
+  for (std::size_t i = 0; i < workers; ++i)
+  {
+    tasks[i].get();
+    lineCount += chunks[i].size();
   }
 
-  // Get line count for pre-allocation.
-  size_t lineCount = 0;
-  for (char* c = _listfile; c < _listfile + fileSize; c++)
-    if (*c == '\0') lineCount++;
+  // Build both maps at the same time. Chunks are visited in file order, so the first
+  // occurrence of a path and of a file data ID win.
+  auto fdidToPath = std::async(std::launch::async, [&]
+  {
+    _fdid_to_path.reserve(lineCount);
+
+    for (auto const& chunk : chunks)
+    {
+      for (auto const& entry : chunk)
+        _fdid_to_path.try_emplace(entry.file_data_id, entry.path);
+    }
+  });
+
   _path_to_fdid.reserve(lineCount);
-  _fdid_to_path.reserve(lineCount);
-
-  // Go line by line, mapping data.
-  char* forward = _listfile;
-  const char* current = _listfile;
-  char* colonPos = nullptr;
-  int uid;
-  while (forward < end)
-  {
-    if (*forward == ';')
-      colonPos = forward;
-    else if (*forward == '\0')
+
+  for (auto const& chunk : chunks)
+  {
+    for (auto const& entry : chunk)
+      _path_to_fdid.try_emplace(entry.path, entry.file_data_id);
+  }
+
+  fdidToPath.get();
+}
+
+void Listfile::initFromCSVAsync(std::string const& listfile_path)
+{
+  waitUntilLoaded();
+
+  std::error_code ec;
+  if (!std::filesystem::is_regular_file(listfile_path, ec))
+    throw Exceptions::Listfile::ListfileNotFoundError();
+
+  _loaded.store(false, std::memory_order_release);
+  _loading = std::async(std::launch::async, [this, listfile_path]
+  {
+    parseCSV(listfile_path);
+    _loaded.store(true, std::memory_order_release);
+  }).share();
+}
+
+std::vector<std::string_view> Listfile::ingestFileList(std::string contents)
+{
+  waitUntilLoaded();
+
+  if (contents.empty())
+    return {};
+
+  // Cleanup and splitting run unlocked, archives ingest their listfiles concurrently.
+  char* data = contents.data();
+  char* end = data + contents.size();
+  Kernels::normalizeText(data, contents.size());
+
+  std::vector<std::string_view> names;
+  names.reserve(Kernels::countByte(data, contents.size(), '\0') + 1);
+
+  for (char* current = data; current < end;)
+  {
+    char* lineEnd = Kernels::findEitherByte(current, end, ';', '\0');
+
+    if (lineEnd > current)
+      names.emplace_back(current, lineEnd - current);
+
+    current = lineEnd + 1;
+  }
+
+  // Archives mostly list the same names, resolve the known ones under a shared lock first.
+  std::vector<std::size_t> missing;
+  {
+    const std::shared_lock _lock(_mutex);
+
+    for (std::size_t i = 0; i < names.size(); ++i)
     {
-      // This warning is unjustified, since colon should be before null.
-      //   1234;testfile.blp\0
-#pragma warning (disable : 6001 6011)
-      *colonPos = '\0';
-#pragma warning (default : 6001 6011)
-      uid = atoi(current);
-      if (!_path_to_fdid.contains(current)) [[unlikely]]
-      {
-        _path_to_fdid[colonPos + 1] = uid;
-        _fdid_to_path[uid] = colonPos + 1;
-      }
-      while (*forward == '\0' && forward < end) forward++;
-      current = forward;
+      auto it = _path_to_fdid.find(names[i]);
+
+      if (it != _path_to_fdid.end())
+        names[i] = it->first;
+      else
+        missing.push_back(i);
     }
-    forward++;
   }
+
+  if (!missing.empty())
+  {
+    const std::unique_lock _lock(_mutex);
+
+    for (std::size_t i : missing)
+    {
+      auto it = _path_to_fdid.find(names[i]);
+
+      if (it == _path_to_fdid.end())
+        it = _path_to_fdid.emplace(storeName(names[i]), 0).first;
+
+      names[i] = it->first;
+    }
+  }
+
+  // Every view now points to the arena or to the CSV buffer, contents can go.
+  return names;
 }
 
-void Listfile::initFromFileList(char* listfileData, size_t listfileSize)
+std::string_view Listfile::storeName(std::string_view name)
 {
-  // TODO: This needs to be stored as an array of pointers, or move cleanup to MPQArchive responsability.
-  if (_listfile) free(_listfile);
+  if (name.size() > _arena_left)
+  {
+    std::size_t const chunk_size = std::max(ArenaChunkSize, name.size());
+    _arena.push_back(std::make_unique<char[]>(chunk_size));
+    _arena_cursor = _arena.back().get();
+    _arena_size += chunk_size;
+    _arena_left = chunk_size;
+  }
+
+  char* destination = _arena_cursor;
+  std::memcpy(destination, name.data(), name.size());
+  _arena_cursor += name.size();
+  _arena_left -= name.size();
+
+  return { destination, name.size() };
+}
+
+void Listfile::initFromBinary(std::string const& binary_path)
+{
+  waitUntilLoaded();
 
-  if (listfileSize <= 2)
+  BlizzardArchive::SharedBuffer image = BlizzardArchive::SharedBuffer::mapFile(binary_path);
+
+  if (!image)
+    throw Exceptions::Listfile::ListfileNotFoundError("listfile.bin was not found by the provided path!");
+
+  BinaryListfile binary(std::move(image));
+
+  releaseCSV();
+  _compact = {};
+  _binary = std::move(binary);
+}
+
+void Listfile::compact(std::size_t bucket_size)
+{
+  waitUntilLoaded();
+
+  if (_path_to_fdid.empty() && _fdid_to_path.empty())
     return;
 
-  listfileSize = (size_t)ceil((float)listfileSize / sizeof(__m128i)) * sizeof(__m128i);
-  listfileData = (char*)realloc(listfileData, listfileSize);
+  // Names merged in from archive listfiles have no file data ID and stay in the map, in the arena.
+  std::vector<std::pair<std::string_view, std::uint32_t>> paths;
+  paths.reserve(_path_to_fdid.size());
 
-  if (!listfileData)
+  for (auto const& [path, file_data_id] : _path_to_fdid)
   {
-    free(listfileData);
-    throw std::exception("Failed to reallocate listfile.");
+    if (file_data_id)
+      paths.emplace_back(path, file_data_id);
+  }
+
+  std::vector<std::pair<std::uint32_t, std::string_view>> file_data_ids(_fdid_to_path.begin(), _fdid_to_path.end());
+
+  _compact = CompactListfile(std::move(paths), std::move(file_data_ids), bucket_size);
+
+  tsl::robin_map<std::string_view, std::uint32_t> archive_names;
+  for (auto const& [path, file_data_id] : _path_to_fdid)
+  {
+    if (!file_data_id && !inCSV(path))
+      archive_names.emplace(path, 0);
+  }
+
+  // Swapping rather than clearing releases the bucket arrays too.
+  archive_names.swap(_path_to_fdid);
+  tsl::robin_map<std::uint32_t, std::string_view>().swap(_fdid_to_path);
+
+  if (_listfile) free(_listfile);
+  _listfile = nullptr;
+  _listfile_size = 0;
+}
+
+bool Listfile::inCSV(std::string_view path) const
+{
+  std::less<char const*> const less;
+  return _listfile && !less(path.data(), _listfile) && less(path.data(), _listfile + _listfile_size);
+}
+
+void Listfile::releaseCSV()
+{
+  if (!_listfile)
     return;
+
+  // The file data ID map only ever points to the CSV buffer.
+  _fdid_to_path.clear();
+
+  tsl::robin_map<std::string_view, std::uint32_t> archive_names;
+  for (auto const& [path, file_data_id] : _path_to_fdid)
+  {
+    if (!inCSV(path))
+      archive_names.emplace(path, file_data_id);
   }
 
-  static const __m128i mmSlashs = _mm_set1_epi8('\\');
-  static const __m128i mmReturns = _mm_set1_epi8('\r');
-  static const __m128i mmNewline = _mm_set1_epi8('\n');
-  static const __m128i mmUpper = _mm_set1_epi8('Z');
-  static const __m128i mmLower = _mm_set1_epi8('A');
-  static const __m128i mmDiff = _mm_set1_epi8('a' - 'A');
-  __m128i mmChars;
-  __m128i mmMask;
-  char* start = listfileData;
-  char* end = listfileData + listfileSize;
-  for (; start < end; start += sizeof(__m128i))
-  {
-    // Load chars into 128bit value.
-    mmChars = _mm_loadu_epi8(start);
-
-    // Check for uppercase
-    // Set mask to 1
-    // Anything less than lower should be 0
-    // Anything more than upper should be 0
-    mmMask = _mm_cmpeq_epi8(
-      _mm_cmpgt_epi8(mmLower, mmChars),
-      _mm_cmpgt_epi8(mmChars, mmUpper)
-    );
-    mmChars = _mm_blendv_epi8(mmChars, _mm_adds_epi8(mmChars, mmDiff), mmMask);
-
-    // Check for backslashes.
-    mmMask = _mm_cmpeq_epi8(mmChars, mmSlashs);
-    mmChars = _mm_blendv_epi8(mmChars, _mm_set1_epi8('/'), mmMask);
-
-    // Check for \r,\n and replace with null.
-    mmMask = _mm_cmpeq_epi8(mmChars, mmReturns);
-    mmChars = _mm_blendv_epi8(mmChars, _mm_set1_epi8('\0'), mmMask);
-    mmMask = _mm_cmpeq_epi8(mmChars, mmNewline);
-    mmChars = _mm_blendv_epi8(mmChars, _mm_set1_epi8('\0'), mmMask);
-
-    // Load 128bit value into chars.
-    _mm_storeu_epi8(start, mmChars);
+  archive_names.swap(_path_to_fdid);
+
+  free(_listfile);
+  _listfile = nullptr;
+  _listfile_size = 0;
+}
+
+std::size_t Listfile::memoryUsage() const
+{
+  waitUntilLoaded();
+
+  // robin_map buckets hold the value plus the probe distance, rounded up by alignment.
+  return _listfile_size
+    + _path_to_fdid.bucket_count() * (sizeof(std::pair<std::string_view, std::uint32_t>) + sizeof(std::uint64_t))
+    + _fdid_to_path.bucket_count() * (sizeof(std::pair<std::uint32_t, std::string_view>) + sizeof(std::uint64_t))
+    + _arena_size
+    + _compact.memoryUsage();
+}
+
+void Listfile::writeBinary(std::string const& binary_path) const
+{
+  waitUntilLoaded();
+
+  // Names merged in from archive listfiles have no file data ID and are left out.
+  std::vector<std::pair<std::string_view, std::uint32_t>> paths;
+  paths.reserve(_path_to_fdid.size());
+
+  for (auto const& [path, file_data_id] : _path_to_fdid)
+  {
+    if (file_data_id)
+      paths.emplace_back(path, file_data_id);
   }
 
-  size_t lineCount = 0;
-  for (char* c = listfileData; c < listfileData + listfileSize; c++)
-    if (*c == '\0') lineCount++;
-  _path_to_fdid.reserve(lineCount);
+  std::vector<std::pair<std::uint32_t, std::string_view>> file_data_ids;
+  file_data_ids.reserve(_fdid_to_path.size());
 
-  char* forward = listfileData;
-  const char* current = listfileData;
-  while (forward < end)
+  for (auto const& [file_data_id, path] : _fdid_to_path)
   {
-    if (*forward == '\0')
-    {
-      if (!_path_to_fdid.contains(current))
-        _path_to_fdid[current] = 0;
-      while (*forward == '\0' && forward < end) forward++;
-      current = forward;
-    }
-    forward++;
+    if (file_data_id)
+      file_data_ids.emplace_back(file_data_id, path);
   }
+
+  BinaryListfile::write(binary_path, std::move(paths), std::move(file_data_ids));
 }
 
 std::uint32_t Listfile::getFileDataID(std::string const& filename) const
 {
-  auto it = _path_to_fdid.find(filename.c_str());
+  waitUntilLoaded();
+
+  if (_binary)
+  {
+    if (std::uint32_t file_data_id = _binary.getFileDataID(filename))
+      return file_data_id;
+  }
+
+  if (_compact)
+  {
+    if (std::uint32_t file_data_id = _compact.getFileDataID(filename))
+      return file_data_id;
+  }
+
+  auto it = _path_to_fdid.find(std::string_view(filename));
   return (it != _path_to_fdid.end()) ? it->second : 0;
 }
 
 std::string_view Listfile::getPath(std::uint32_t file_data_id) const
 {
+  waitUntilLoaded();
+
+  if (_binary)
+    return _binary.getPath(file_data_id);
+
+  if (_compact)
+    return _compact.getPath(file_data_id);
+
   auto it = _fdid_to_path.find(file_data_id);
   return (it != _fdid_to_path.end()) ? it->second : "";
 }
 
+void Listfile::forEachEntry(std::function<void(std::string_view, std::uint32_t)> const& visitor) const
+{
+  waitUntilLoaded();
+
+  if (_binary)
+    _binary.forEachEntry(visitor);
+
+  if (_compact)
+    _compact.forEachEntry(visitor);
+
+  for (auto const& [path, file_data_id] : _path_to_fdid)
+  {
+    visitor(path, file_data_id);
+  }
+}
+
 bool FileKey::deduceOtherComponent(const Listfile* listfile)
 {
   if (hasFileDataID() && !hasFilepath())
@@ -262,7 +499,9 @@ bool FileKey::deduceOtherComponent(const Listfile* listfile)
       return false;
     }
 
-    _file_path = path;
+    // Listfile paths are part of the client's file set, which bounds the pool.
+    _path_id = PathPool::instance().intern(path);
+    _unpooled_path = nullptr;
     return true;
 
   }
@@ -290,21 +529,40 @@ bool FileKey::operator==(const FileKey& rhs) const
   }
   else if (hasFilepath() && rhs.hasFilepath())
   {
-    return filepath() == rhs.filepath();
+    return samePath(rhs);
   }
 
   return false;
 }
 
-FileKey::FileKey(FileKey&& other) noexcept
+bool FileKey::samePath(FileKey const& rhs) const
 {
-  std::swap(_file_data_id, other._file_data_id);
-  std::swap(_file_path, other._file_path);
+  // Interned, equal paths have equal IDs. A path missing from the pool may have been added since.
+  if (!_unpooled_path && !rhs._unpooled_path)
+    return _path_id == rhs._path_id;
+
+  return filepath() == rhs.filepath();
+}
+
+std::string const& FileKey::filepath() const
+{
+  if (!hasFilepath())
+    throw std::bad_optional_access();
+
+  return _unpooled_path ? *_unpooled_path : PathPool::instance().path(_path_id);
 }
 
 std::string FileKey::stringRepr() const
 {
-  return hasFilepath() ? _file_path.value() : std::to_string(_file_data_id);
+  return hasFilepath() ? filepath() : std::to_string(_file_data_id);
+}
+
+std::size_t FileKey::hash() const
+{
+  // The pool hashes paths the same way, pooled and unpooled copies of a path hash alike.
+  std::size_t const path_hash = _unpooled_path ? std::hash<std::string_view>{}(*_unpooled_path)
+    : hasFilepath() ? PathPool::instance().hash(_path_id) : 0;
+  return path_hash ^ (std::hash<std::uint32_t>{}(_file_data_id) + 0x9E3779B97F4A7C15ull + (path_hash << 6) + (path_hash >> 2));
 }
 
 bool FileKey::operator<(const FileKey& rhs) const
@@ -315,30 +573,13 @@ bool FileKey::operator<(const FileKey& rhs) const
   }
   else if (hasFilepath() && rhs.hasFilepath())
   {
-    return filepath() < rhs.filepath();
+    return !samePath(rhs) && filepath() < rhs.filepath();
   }
 
   return false;
 }
 
-FileKey& FileKey::operator=(FileKey&& other) noexcept
-{
-  std::swap(_file_data_id, other._file_data_id);
-  std::swap(_file_path, other._file_path);
-  return *this;
-}
-
-FileKey::FileKey(FileKey const& other)
-: _file_data_id(other._file_data_id)
-, _file_path(other._file_path)
+BlizzardArchive::Archive::MPQNameHash FileKey::mpqHash() const
 {
+  return _unpooled_path ? BlizzardArchive::Archive::hashMPQName(*_unpooled_path) : PathPool::instance().mpqHash(_path_id);
 }
-
-FileKey& FileKey::operator= (FileKey const& other)
-{
-  _file_data_id = other._file_data_id;
-  _file_path = other._file_path;
-
-  return *this;
-}
-
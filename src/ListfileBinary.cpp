@@ -0,0 +1,348 @@
+#include <ListfileBinary.hpp>
+#include <FileReplace.hpp>
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+using namespace BlizzardArchive::Listfile;
+
+namespace
+{
+  // Average number of paths per bucket of the perfect hash, trades pilot space for build time.
+  constexpr std::uint32_t AverageBucketSize = 5;
+
+  // A bucket whose pilot search exceeds this restarts the build with another seed.
+  constexpr std::uint32_t MaxPilot = 1 << 20;
+  constexpr std::uint64_t MaxSeedAttempts = 16;
+
+  struct Layout
+  {
+    std::size_t path_offsets;
+    std::size_t path_fdids;
+    std::size_t pilots;
+    std::size_t slots;
+    std::size_t fdids;
+    std::size_t fdid_paths;
+    std::size_t blob;
+    std::size_t total;
+  };
+
+  std::size_t align(std::size_t offset)
+  {
+    return (offset + 7) & ~std::size_t(7);
+  }
+
+  template<typename Header>
+  Layout computeLayout(Header const& header)
+  {
+    Layout layout;
+    std::size_t offset = align(sizeof(Header));
+
+    layout.path_offsets = offset;
+    offset = align(offset + (std::size_t(header.path_count) + 1) * sizeof(std::uint32_t));
+    layout.path_fdids = offset;
+    offset = align(offset + std::size_t(header.path_count) * sizeof(std::uint32_t));
+    layout.pilots = offset;
+    offset = align(offset + std::size_t(header.bucket_count) * sizeof(std::uint32_t));
+    layout.slots = offset;
+    offset = align(offset + std::size_t(header.slot_count) * sizeof(std::uint32_t));
+    layout.fdids = offset;
+    offset = align(offset + std::size_t(header.fdid_count) * sizeof(std::uint32_t));
+    layout.fdid_paths = offset;
+    offset = align(offset + std::size_t(header.fdid_count) * sizeof(std::uint32_t));
+    layout.blob = offset;
+    layout.total = offset + header.blob_size;
+
+    return layout;
+  }
+
+  std::uint64_t mix(std::uint64_t value)
+  {
+    value ^= value >> 30;
+    value *= 0xBF58476D1CE4E5B9;
+    value ^= value >> 27;
+    value *= 0x94D049BB133111EB;
+    value ^= value >> 31;
+    return value;
+  }
+
+  // Stable across builds and platforms of the same endianness, unlike std::hash.
+  std::uint64_t hashPath(std::string_view path, std::uint64_t seed)
+  {
+    std::uint64_t hash = mix(seed ^ path.size());
+
+    std::size_t i = 0;
+    for (; i + sizeof(std::uint64_t) <= path.size(); i += sizeof(std::uint64_t))
+    {
+      std::uint64_t word;
+      std::memcpy(&word, path.data() + i, sizeof(word));
+      hash = std::rotl((hash ^ word) * 0x9E3779B97F4A7C15, 29);
+    }
+
+    std::uint64_t tail = 0;
+    std::memcpy(&tail, path.data() + i, path.size() - i);
+
+    return mix(hash ^ tail);
+  }
+
+  std::uint32_t bucketOf(std::uint64_t hash, std::uint32_t bucket_count)
+  {
+    return static_cast<std::uint32_t>((hash >> 32) % bucket_count);
+  }
+
+  std::uint32_t slotOf(std::uint64_t hash, std::uint32_t pilot, std::uint64_t seed, std::uint32_t slot_count)
+  {
+    return static_cast<std::uint32_t>((hash ^ mix(pilot ^ seed)) % slot_count);
+  }
+
+  // Finds a pilot for every bucket, biggest buckets first. False if the seed has to be changed.
+  bool buildPerfectHash(std::vector<std::pair<std::string_view, std::uint32_t>> const& paths
+    , std::uint64_t seed
+    , std::uint32_t bucket_count
+    , std::uint32_t slot_count
+    , std::vector<std::uint32_t>& pilots
+    , std::vector<std::uint32_t>& slots
+    , std::uint32_t empty_slot)
+  {
+    std::vector<std::uint64_t> hashes(paths.size());
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> keys(paths.size());
+
+    for (std::uint32_t i = 0; i < paths.size(); ++i)
+    {
+      hashes[i] = hashPath(paths[i].first, seed);
+      keys[i] = { bucketOf(hashes[i], bucket_count), i };
+    }
+
+    std::sort(keys.begin(), keys.end());
+
+    // Ranges of keys sharing a bucket.
+    std::vector<std::pair<std::size_t, std::size_t>> buckets;
+    for (std::size_t begin = 0; begin < keys.size();)
+    {
+      std::size_t end = begin + 1;
+      while (end < keys.size() && keys[end].first == keys[begin].first)
+        ++end;
+
+      buckets.emplace_back(begin, end);
+      begin = end;
+    }
+
+    std::stable_sort(buckets.begin(), buckets.end(), [](auto const& lhs, auto const& rhs)
+    {
+      return lhs.second - lhs.first > rhs.second - rhs.first;
+    });
+
+    pilots.assign(bucket_count, 0);
+    slots.assign(slot_count, empty_slot);
+
+    std::vector<std::uint32_t> positions;
+    for (auto const& [begin, end] : buckets)
+    {
+      std::uint32_t pilot = 0;
+      for (;; ++pilot)
+      {
+        if (pilot == MaxPilot)
+          return false;
+
+        positions.clear();
+        for (std::size_t i = begin; i < end; ++i)
+        {
+          std::uint32_t position = slotOf(hashes[keys[i].second], pilot, seed, slot_count);
+
+          if (slots[position] != empty_slot || std::find(positions.begin(), positions.end(), position) != positions.end())
+            break;
+
+          positions.push_back(position);
+        }
+
+        if (positions.size() == end - begin)
+          break;
+      }
+
+      pilots[keys[begin].first] = pilot;
+      for (std::size_t i = begin; i < end; ++i)
+      {
+        slots[positions[i - begin]] = keys[i].second;
+      }
+    }
+
+    return true;
+  }
+}
+
+BinaryListfile::BinaryListfile(SharedBuffer image)
+: _image(std::move(image))
+{
+  if (_image.size() < sizeof(Header))
+    throw std::runtime_error("Binary listfile is truncated.");
+
+  std::memcpy(&_header, _image.data(), sizeof(Header));
+
+  if (std::memcmp(_header.magic, Magic, sizeof(Magic)) != 0)
+    throw std::runtime_error("Not a binary listfile.");
+
+  if (!_header.bucket_count || !_header.slot_count)
+    throw std::runtime_error("Binary listfile is corrupted.");
+
+  Layout const layout = computeLayout(_header);
+
+  if (layout.total > _image.size())
+    throw std::runtime_error("Binary listfile is truncated.");
+
+  // Mappings are page aligned and every section is 8 byte aligned within the image.
+  char const* data = _image.data();
+  _path_offsets = reinterpret_cast<std::uint32_t const*>(data + layout.path_offsets);
+  _path_fdids = reinterpret_cast<std::uint32_t const*>(data + layout.path_fdids);
+  _pilots = reinterpret_cast<std::uint32_t const*>(data + layout.pilots);
+  _slots = reinterpret_cast<std::uint32_t const*>(data + layout.slots);
+  _fdids = reinterpret_cast<std::uint32_t const*>(data + layout.fdids);
+  _fdid_paths = reinterpret_cast<std::uint32_t const*>(data + layout.fdid_paths);
+  _blob = data + layout.blob;
+
+  if (_path_offsets[_header.path_count] != _header.blob_size)
+    throw std::runtime_error("Binary listfile is corrupted.");
+}
+
+void BinaryListfile::write(std::string const& path
+  , std::vector<std::pair<std::string_view, std::uint32_t>> paths
+  , std::vector<std::pair<std::uint32_t, std::string_view>> file_data_ids)
+{
+  std::sort(paths.begin(), paths.end());
+  paths.erase(std::unique(paths.begin(), paths.end()
+    , [](auto const& lhs, auto const& rhs) { return lhs.first == rhs.first; }), paths.end());
+
+  std::sort(file_data_ids.begin(), file_data_ids.end());
+  file_data_ids.erase(std::unique(file_data_ids.begin(), file_data_ids.end()
+    , [](auto const& lhs, auto const& rhs) { return lhs.first == rhs.first; }), file_data_ids.end());
+
+  if (paths.size() >= EmptySlot)
+    throw std::runtime_error("Too many paths for a binary listfile.");
+
+  // Resolve the path of every file data ID to its index, dropping the ones with an unknown path.
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> fdid_paths;
+  fdid_paths.reserve(file_data_ids.size());
+
+  for (auto const& [file_data_id, fdid_path] : file_data_ids)
+  {
+    auto it = std::lower_bound(paths.begin(), paths.end(), fdid_path
+      , [](auto const& entry, std::string_view value) { return entry.first < value; });
+
+    if (it != paths.end() && it->first == fdid_path)
+      fdid_paths.emplace_back(file_data_id, static_cast<std::uint32_t>(it - paths.begin()));
+  }
+
+  Header header = {};
+  std::memcpy(header.magic, Magic, sizeof(Magic));
+  header.path_count = static_cast<std::uint32_t>(paths.size());
+  header.fdid_count = static_cast<std::uint32_t>(fdid_paths.size());
+  header.bucket_count = std::max<std::uint32_t>(1, header.path_count / AverageBucketSize);
+  header.slot_count = std::max<std::uint32_t>(1, header.path_count + header.path_count / 50);
+
+  for (auto const& entry : paths)
+  {
+    header.blob_size += entry.first.size();
+  }
+
+  if (header.blob_size > 0xFFFFFFFF)
+    throw std::runtime_error("Too many paths for a binary listfile.");
+
+  std::vector<std::uint32_t> pilots;
+  std::vector<std::uint32_t> slots;
+
+  for (;; ++header.seed)
+  {
+    if (header.seed == MaxSeedAttempts)
+      throw std::runtime_error("Failed to build the binary listfile hash.");
+
+    if (buildPerfectHash(paths, header.seed, header.bucket_count, header.slot_count, pilots, slots, EmptySlot))
+      break;
+  }
+
+  Layout const layout = computeLayout(header);
+  std::vector<char> image(layout.total, 0);
+  std::memcpy(image.data(), &header, sizeof(Header));
+
+  auto section = [&](std::size_t offset) { return reinterpret_cast<std::uint32_t*>(image.data() + offset); };
+
+  std::uint32_t* path_offsets = section(layout.path_offsets);
+  std::uint32_t* path_fdids = section(layout.path_fdids);
+  std::uint32_t blob_offset = 0;
+
+  for (std::size_t i = 0; i < paths.size(); ++i)
+  {
+    path_offsets[i] = blob_offset;
+    path_fdids[i] = paths[i].second;
+    std::memcpy(image.data() + layout.blob + blob_offset, paths[i].first.data(), paths[i].first.size());
+    blob_offset += static_cast<std::uint32_t>(paths[i].first.size());
+  }
+  path_offsets[paths.size()] = blob_offset;
+
+  std::memcpy(section(layout.pilots), pilots.data(), pilots.size() * sizeof(std::uint32_t));
+  std::memcpy(section(layout.slots), slots.data(), slots.size() * sizeof(std::uint32_t));
+
+  std::uint32_t* fdids = section(layout.fdids);
+  std::uint32_t* fdid_path_indices = section(layout.fdid_paths);
+  for (std::size_t i = 0; i < fdid_paths.size(); ++i)
+  {
+    fdids[i] = fdid_paths[i].first;
+    fdid_path_indices[i] = fdid_paths[i].second;
+  }
+
+  if (!replaceFile(path, [&](std::ostream& stream) { stream.write(image.data(), image.size()); }))
+    throw std::runtime_error("Failed to write binary listfile.");
+}
+
+std::uint32_t BinaryListfile::getFileDataID(std::string_view path) const
+{
+  if (!_image || !_header.path_count)
+    return 0;
+
+  std::uint64_t const hash = hashPath(path, _header.seed);
+  std::uint32_t const pilot = _pilots[bucketOf(hash, _header.bucket_count)];
+  std::uint32_t const index = _slots[slotOf(hash, pilot, _header.seed, _header.slot_count)];
+
+  // Paths absent from the listfile land on an arbitrary slot, the stored path tells them apart.
+  if (index >= _header.path_count || pathAt(index) != path)
+    return 0;
+
+  return _path_fdids[index];
+}
+
+std::string_view BinaryListfile::getPath(std::uint32_t file_data_id) const
+{
+  if (!_image)
+    return {};
+
+  std::uint32_t const* end = _fdids + _header.fdid_count;
+  std::uint32_t const* it = std::lower_bound(_fdids, end, file_data_id);
+
+  if (it == end || *it != file_data_id)
+    return {};
+
+  std::uint32_t const index = _fdid_paths[it - _fdids];
+
+  if (index >= _header.path_count)
+    return {};
+
+  return pathAt(index);
+}
+
+void BinaryListfile::forEachEntry(std::function<void(std::string_view, std::uint32_t)> const& visitor) const
+{
+  for (std::uint32_t i = 0; i < _header.path_count; ++i)
+  {
+    visitor(pathAt(i), _path_fdids[i]);
+  }
+}
+
+std::string_view BinaryListfile::pathAt(std::uint32_t index) const
+{
+  std::uint32_t const begin = _path_offsets[index];
+  std::uint32_t const end = _path_offsets[index + 1];
+
+  if (begin > end || end > _header.blob_size)
+    return {};
+
+  return { _blob + begin, end - begin };
+}
@@ -0,0 +1,213 @@
+#include <ListfileCompact.hpp>
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+
+using namespace BlizzardArchive::Listfile;
+
+namespace
+{
+  void writeVarint(std::vector<char>& data, std::size_t value)
+  {
+    while (value >= 0x80)
+    {
+      data.push_back(static_cast<char>((value & 0x7F) | 0x80));
+      value >>= 7;
+    }
+
+    data.push_back(static_cast<char>(value));
+  }
+
+  std::size_t readVarint(char const*& current)
+  {
+    std::size_t value = 0;
+    for (unsigned shift = 0;; shift += 7)
+    {
+      unsigned char const byte = static_cast<unsigned char>(*current++);
+      value |= std::size_t(byte & 0x7F) << shift;
+
+      if (!(byte & 0x80))
+        return value;
+    }
+  }
+}
+
+CompactListfile::CompactListfile(std::vector<std::pair<std::string_view, std::uint32_t>> paths
+  , std::vector<std::pair<std::uint32_t, std::string_view>> file_data_ids
+  , std::size_t bucket_size)
+: _bucket_size(std::max<std::size_t>(1, bucket_size))
+{
+  std::sort(paths.begin(), paths.end());
+  paths.erase(std::unique(paths.begin(), paths.end()
+    , [](auto const& lhs, auto const& rhs) { return lhs.first == rhs.first; }), paths.end());
+
+  std::sort(file_data_ids.begin(), file_data_ids.end());
+  file_data_ids.erase(std::unique(file_data_ids.begin(), file_data_ids.end()
+    , [](auto const& lhs, auto const& rhs) { return lhs.first == rhs.first; }), file_data_ids.end());
+
+  _path_fdids.reserve(paths.size());
+  _bucket_offsets.reserve(paths.size() / _bucket_size + 1);
+
+  std::string_view previous;
+  for (std::size_t i = 0; i < paths.size(); ++i)
+  {
+    std::string_view const path = paths[i].first;
+
+    if (i % _bucket_size == 0)
+    {
+      if (_data.size() > 0xFFFFFFFF)
+        throw std::runtime_error("Listfile is too big to be compacted.");
+
+      _bucket_offsets.push_back(static_cast<std::uint32_t>(_data.size()));
+      writeVarint(_data, path.size());
+      _data.insert(_data.end(), path.begin(), path.end());
+    }
+    else
+    {
+      std::size_t const shared = std::mismatch(previous.begin(), previous.end(), path.begin(), path.end()).first - previous.begin();
+      writeVarint(_data, shared);
+      writeVarint(_data, path.size() - shared);
+      _data.insert(_data.end(), path.begin() + shared, path.end());
+    }
+
+    _path_fdids.push_back(paths[i].second);
+    previous = path;
+  }
+
+  _data.shrink_to_fit();
+
+  _fdids.reserve(file_data_ids.size());
+  _fdid_paths.reserve(file_data_ids.size());
+
+  for (auto const& [file_data_id, path] : file_data_ids)
+  {
+    auto it = std::lower_bound(paths.begin(), paths.end(), path
+      , [](auto const& entry, std::string_view value) { return entry.first < value; });
+
+    if (it == paths.end() || it->first != path)
+      continue;
+
+    _fdids.push_back(file_data_id);
+    _fdid_paths.push_back(static_cast<std::uint32_t>(it - paths.begin()));
+  }
+
+  _fdids.shrink_to_fit();
+  _fdid_paths.shrink_to_fit();
+}
+
+std::string_view CompactListfile::bucketHead(std::size_t bucket) const
+{
+  char const* current = _data.data() + _bucket_offsets[bucket];
+  std::size_t const size = readVarint(current);
+  return { current, size };
+}
+
+template<typename Visitor>
+void CompactListfile::visitBucket(std::size_t bucket, std::string& path, Visitor&& visitor) const
+{
+  std::size_t const first = bucket * _bucket_size;
+  std::size_t const last = std::min(first + _bucket_size, _path_fdids.size());
+
+  path = bucketHead(bucket);
+  char const* current = _data.data() + _bucket_offsets[bucket];
+  readVarint(current);
+  current += path.size();
+
+  for (std::size_t index = first;;)
+  {
+    if (!visitor(index, std::string_view(path)) || ++index == last)
+      return;
+
+    std::size_t const shared = readVarint(current);
+    std::size_t const suffix = readVarint(current);
+    path.resize(shared);
+    path.append(current, suffix);
+    current += suffix;
+  }
+}
+
+std::uint32_t CompactListfile::getFileDataID(std::string_view path) const
+{
+  if (_bucket_offsets.empty())
+    return 0;
+
+  // Last bucket whose head is not greater than the path.
+  std::size_t low = 0;
+  std::size_t high = _bucket_offsets.size();
+  while (high - low > 1)
+  {
+    std::size_t const middle = (low + high) / 2;
+
+    if (bucketHead(middle) <= path)
+      low = middle;
+    else
+      high = middle;
+  }
+
+  thread_local std::string scratch;
+  std::uint32_t file_data_id = 0;
+
+  visitBucket(low, scratch, [&](std::size_t index, std::string_view candidate)
+  {
+    if (candidate == path)
+      file_data_id = _path_fdids[index];
+
+    return candidate < path;
+  });
+
+  return file_data_id;
+}
+
+std::string_view CompactListfile::getPath(std::uint32_t file_data_id) const
+{
+  auto it = std::lower_bound(_fdids.begin(), _fdids.end(), file_data_id);
+
+  if (it == _fdids.end() || *it != file_data_id)
+    return {};
+
+  {
+    std::shared_lock const lock(_decoded->mutex);
+
+    if (auto decoded = _decoded->paths.find(file_data_id); decoded != _decoded->paths.end())
+      return decoded->second;
+  }
+
+  std::size_t const target = _fdid_paths[it - _fdids.begin()];
+
+  std::string path;
+  visitBucket(target / _bucket_size, path, [&](std::size_t index, std::string_view)
+  {
+    return index != target;
+  });
+
+  // Node based, the strings do not move when the map grows.
+  std::unique_lock const lock(_decoded->mutex);
+  auto [decoded, inserted] = _decoded->paths.try_emplace(file_data_id, std::move(path));
+
+  if (inserted)
+    _decoded->size += sizeof(std::pair<std::uint32_t const, std::string>) + 2 * sizeof(void*) + decoded->second.capacity();
+
+  return decoded->second;
+}
+
+void CompactListfile::forEachEntry(std::function<void(std::string_view, std::uint32_t)> const& visitor) const
+{
+  std::string path;
+  for (std::size_t bucket = 0; bucket < _bucket_offsets.size(); ++bucket)
+  {
+    visitBucket(bucket, path, [&](std::size_t index, std::string_view current)
+    {
+      visitor(current, _path_fdids[index]);
+      return true;
+    });
+  }
+}
+
+std::size_t CompactListfile::memoryUsage() const
+{
+  std::shared_lock const lock(_decoded->mutex);
+
+  return _data.capacity()
+    + _decoded->size
+    + (_bucket_offsets.capacity() + _path_fdids.capacity() + _fdids.capacity() + _fdid_paths.capacity()) * sizeof(std::uint32_t);
+}
@@ -0,0 +1,394 @@
+#include <ListfileKernels.hpp>
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define BLIZZARD_ARCHIVE_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC exposes every intrinsic without per-function target flags.
+#define BLIZZARD_ARCHIVE_TARGET(isa)
+#else
+#define BLIZZARD_ARCHIVE_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+using namespace BlizzardArchive::Listfile;
+
+namespace
+{
+  inline char normalizeChar(char c)
+  {
+    if (c >= 'A' && c <= 'Z')
+      return c + ('a' - 'A');
+    if (c == '\\')
+      return '/';
+    if (c == '\r' || c == '\n')
+      return '\0';
+    return c;
+  }
+
+  void normalizeTextScalar(char* data, std::size_t size)
+  {
+    for (char* end = data + size; data < end; ++data)
+      *data = normalizeChar(*data);
+  }
+
+  std::size_t countByteScalar(char const* data, std::size_t size, char value)
+  {
+    std::size_t count = 0;
+    for (char const* end = data + size; data < end; ++data)
+      count += *data == value;
+    return count;
+  }
+
+  char* findEitherByteScalar(char* begin, char* end, char first, char second)
+  {
+    for (; begin < end; ++begin)
+    {
+      if (*begin == first || *begin == second)
+        return begin;
+    }
+    return end;
+  }
+
+#ifdef BLIZZARD_ARCHIVE_X86
+  BLIZZARD_ARCHIVE_TARGET("sse4.1")
+  void normalizeTextSSE41(char* data, std::size_t size)
+  {
+    __m128i const before_upper = _mm_set1_epi8('A' - 1);
+    __m128i const after_upper = _mm_set1_epi8('Z' + 1);
+    __m128i const case_difference = _mm_set1_epi8('a' - 'A');
+    __m128i const backslash = _mm_set1_epi8('\\');
+    __m128i const slash = _mm_set1_epi8('/');
+    __m128i const carriage_return = _mm_set1_epi8('\r');
+    __m128i const newline = _mm_set1_epi8('\n');
+
+    char* end = data + size;
+    for (; data + sizeof(__m128i) <= end; data += sizeof(__m128i))
+    {
+      __m128i chars = _mm_loadu_si128(reinterpret_cast<__m128i const*>(data));
+
+      __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(chars, before_upper), _mm_cmpgt_epi8(after_upper, chars));
+      chars = _mm_add_epi8(chars, _mm_and_si128(upper, case_difference));
+      chars = _mm_blendv_epi8(chars, slash, _mm_cmpeq_epi8(chars, backslash));
+
+      __m128i line_end = _mm_or_si128(_mm_cmpeq_epi8(chars, carriage_return), _mm_cmpeq_epi8(chars, newline));
+      chars = _mm_andnot_si128(line_end, chars);
+
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(data), chars);
+    }
+
+    normalizeTextScalar(data, end - data);
+  }
+
+  BLIZZARD_ARCHIVE_TARGET("sse4.1")
+  std::size_t countByteSSE41(char const* data, std::size_t size, char value)
+  {
+    __m128i const needle = _mm_set1_epi8(value);
+    std::size_t count = 0;
+
+    char const* end = data + size;
+    for (; data + sizeof(__m128i) <= end; data += sizeof(__m128i))
+    {
+      __m128i chars = _mm_loadu_si128(reinterpret_cast<__m128i const*>(data));
+      count += std::popcount(static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chars, needle))));
+    }
+
+    return count + countByteScalar(data, end - data, value);
+  }
+
+  BLIZZARD_ARCHIVE_TARGET("sse4.1")
+  char* findEitherByteSSE41(char* begin, char* end, char first, char second)
+  {
+    __m128i const first_needle = _mm_set1_epi8(first);
+    __m128i const second_needle = _mm_set1_epi8(second);
+
+    for (; begin + sizeof(__m128i) <= end; begin += sizeof(__m128i))
+    {
+      __m128i chars = _mm_loadu_si128(reinterpret_cast<__m128i const*>(begin));
+      std::uint32_t mask = static_cast<std::uint32_t>(_mm_movemask_epi8(
+        _mm_or_si128(_mm_cmpeq_epi8(chars, first_needle), _mm_cmpeq_epi8(chars, second_needle))));
+
+      if (mask)
+        return begin + std::countr_zero(mask);
+    }
+
+    return findEitherByteScalar(begin, end, first, second);
+  }
+
+  BLIZZARD_ARCHIVE_TARGET("avx2")
+  void normalizeTextAVX2(char* data, std::size_t size)
+  {
+    __m256i const before_upper = _mm256_set1_epi8('A' - 1);
+    __m256i const after_upper = _mm256_set1_epi8('Z' + 1);
+    __m256i const case_difference = _mm256_set1_epi8('a' - 'A');
+    __m256i const backslash = _mm256_set1_epi8('\\');
+    __m256i const slash = _mm256_set1_epi8('/');
+    __m256i const carriage_return = _mm256_set1_epi8('\r');
+    __m256i const newline = _mm256_set1_epi8('\n');
+
+    char* end = data + size;
+    for (; data + sizeof(__m256i) <= end; data += sizeof(__m256i))
+    {
+      __m256i chars = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(data));
+
+      __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(chars, before_upper), _mm256_cmpgt_epi8(after_upper, chars));
+      chars = _mm256_add_epi8(chars, _mm256_and_si256(upper, case_difference));
+      chars = _mm256_blendv_epi8(chars, slash, _mm256_cmpeq_epi8(chars, backslash));
+
+      __m256i line_end = _mm256_or_si256(_mm256_cmpeq_epi8(chars, carriage_return), _mm256_cmpeq_epi8(chars, newline));
+      chars = _mm256_andnot_si256(line_end, chars);
+
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(data), chars);
+    }
+
+    normalizeTextSSE41(data, end - data);
+  }
+
+  BLIZZARD_ARCHIVE_TARGET("avx2")
+  std::size_t countByteAVX2(char const* data, std::size_t size, char value)
+  {
+    __m256i const needle = _mm256_set1_epi8(value);
+    std::size_t count = 0;
+
+    char const* end = data + size;
+    for (; data + sizeof(__m256i) <= end; data += sizeof(__m256i))
+    {
+      __m256i chars = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(data));
+      count += std::popcount(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chars, needle))));
+    }
+
+    return count + countByteSSE41(data, end - data, value);
+  }
+
+  BLIZZARD_ARCHIVE_TARGET("avx2")
+  char* findEitherByteAVX2(char* begin, char* end, char first, char second)
+  {
+    __m256i const first_needle = _mm256_set1_epi8(first);
+    __m256i const second_needle = _mm256_set1_epi8(second);
+
+    for (; begin + sizeof(__m256i) <= end; begin += sizeof(__m256i))
+    {
+      __m256i chars = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(begin));
+      std::uint32_t mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_cmpeq_epi8(chars, first_needle), _mm256_cmpeq_epi8(chars, second_needle))));
+
+      if (mask)
+        return begin + std::countr_zero(mask);
+    }
+
+    return findEitherByteSSE41(begin, end, first, second);
+  }
+
+  // AVX-512BW handles the tail with masked loads and stores, no scalar remainder loop is needed.
+  BLIZZARD_ARCHIVE_TARGET("avx512f,avx512bw")
+  void normalizeTextAVX512BW(char* data, std::size_t size)
+  {
+    __m512i const case_difference = _mm512_set1_epi8('a' - 'A');
+    __m512i const upper_first = _mm512_set1_epi8('A');
+    __m512i const upper_last = _mm512_set1_epi8('Z');
+    __m512i const backslash = _mm512_set1_epi8('\\');
+    __m512i const slash = _mm512_set1_epi8('/');
+    __m512i const carriage_return = _mm512_set1_epi8('\r');
+    __m512i const newline = _mm512_set1_epi8('\n');
+    __m512i const zero = _mm512_setzero_si512();
+
+    char* end = data + size;
+    while (data < end)
+    {
+      std::size_t const remaining = static_cast<std::size_t>(end - data);
+      __mmask64 const lanes = remaining >= 64 ? ~__mmask64(0) : (__mmask64(1) << remaining) - 1;
+
+      __m512i chars = _mm512_maskz_loadu_epi8(lanes, data);
+
+      __mmask64 upper = _mm512_cmpge_epi8_mask(chars, upper_first) & _mm512_cmple_epi8_mask(chars, upper_last);
+      chars = _mm512_mask_add_epi8(chars, upper, chars, case_difference);
+      chars = _mm512_mask_mov_epi8(chars, _mm512_cmpeq_epi8_mask(chars, backslash), slash);
+
+      __mmask64 line_end = _mm512_cmpeq_epi8_mask(chars, carriage_return) | _mm512_cmpeq_epi8_mask(chars, newline);
+      chars = _mm512_mask_mov_epi8(chars, line_end, zero);
+
+      _mm512_mask_storeu_epi8(data, lanes, chars);
+      data += remaining >= 64 ? 64 : remaining;
+    }
+  }
+
+  BLIZZARD_ARCHIVE_TARGET("avx512f,avx512bw")
+  std::size_t countByteAVX512BW(char const* data, std::size_t size, char value)
+  {
+    __m512i const needle = _mm512_set1_epi8(value);
+    std::size_t count = 0;
+
+    char const* end = data + size;
+    while (data < end)
+    {
+      std::size_t const remaining = static_cast<std::size_t>(end - data);
+      __mmask64 const lanes = remaining >= 64 ? ~__mmask64(0) : (__mmask64(1) << remaining) - 1;
+
+      __m512i chars = _mm512_maskz_loadu_epi8(lanes, data);
+      count += std::popcount(static_cast<std::uint64_t>(_mm512_mask_cmpeq_epi8_mask(lanes, chars, needle)));
+      data += remaining >= 64 ? 64 : remaining;
+    }
+
+    return count;
+  }
+
+  BLIZZARD_ARCHIVE_TARGET("avx512f,avx512bw")
+  char* findEitherByteAVX512BW(char* begin, char* end, char first, char second)
+  {
+    __m512i const first_needle = _mm512_set1_epi8(first);
+    __m512i const second_needle = _mm512_set1_epi8(second);
+
+    while (begin < end)
+    {
+      std::size_t const remaining = static_cast<std::size_t>(end - begin);
+      __mmask64 const lanes = remaining >= 64 ? ~__mmask64(0) : (__mmask64(1) << remaining) - 1;
+
+      __m512i chars = _mm512_maskz_loadu_epi8(lanes, begin);
+      std::uint64_t mask = _mm512_mask_cmpeq_epi8_mask(lanes, chars, first_needle)
+        | _mm512_mask_cmpeq_epi8_mask(lanes, chars, second_needle);
+
+      if (mask)
+        return begin + std::countr_zero(mask);
+
+      begin += remaining >= 64 ? 64 : remaining;
+    }
+
+    return end;
+  }
+
+  bool cpuSupports(Kernels::InstructionSet instruction_set)
+  {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    int const max_leaf = info[0];
+
+    __cpuid(info, 1);
+    bool const sse41 = info[2] & (1 << 19);
+    bool const os_saves_avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 0x6) == 0x6;
+
+    int extended[4] = {};
+    if (max_leaf >= 7)
+      __cpuidex(extended, 7, 0);
+
+    switch (instruction_set)
+    {
+      case Kernels::InstructionSet::SSE41:
+        return sse41;
+      case Kernels::InstructionSet::AVX2:
+        return os_saves_avx && (extended[1] & (1 << 5));
+      case Kernels::InstructionSet::AVX512BW:
+        return os_saves_avx && (_xgetbv(0) & 0xE6) == 0xE6 && (extended[1] & (1 << 16)) && (extended[1] & (1 << 30));
+      default:
+        return true;
+    }
+#else
+    // The builtins also check that the OS saves the wider register state.
+    __builtin_cpu_init();
+
+    switch (instruction_set)
+    {
+      case Kernels::InstructionSet::SSE41:
+        return __builtin_cpu_supports("sse4.1");
+      case Kernels::InstructionSet::AVX2:
+        return __builtin_cpu_supports("avx2");
+      case Kernels::InstructionSet::AVX512BW:
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+      default:
+        return true;
+    }
+#endif
+  }
+#else
+  bool cpuSupports(Kernels::InstructionSet instruction_set)
+  {
+    return instruction_set == Kernels::InstructionSet::SCALAR;
+  }
+#endif
+
+  struct KernelTable
+  {
+    Kernels::InstructionSet instruction_set;
+    void (*normalize_text)(char*, std::size_t);
+    std::size_t (*count_byte)(char const*, std::size_t, char);
+    char* (*find_either_byte)(char*, char*, char, char);
+  };
+
+  KernelTable const* kernelTable(Kernels::InstructionSet instruction_set)
+  {
+    static constexpr KernelTable Scalar { Kernels::InstructionSet::SCALAR, normalizeTextScalar, countByteScalar, findEitherByteScalar };
+#ifdef BLIZZARD_ARCHIVE_X86
+    static constexpr KernelTable SSE41 { Kernels::InstructionSet::SSE41, normalizeTextSSE41, countByteSSE41, findEitherByteSSE41 };
+    static constexpr KernelTable AVX2 { Kernels::InstructionSet::AVX2, normalizeTextAVX2, countByteAVX2, findEitherByteAVX2 };
+    static constexpr KernelTable AVX512BW { Kernels::InstructionSet::AVX512BW, normalizeTextAVX512BW, countByteAVX512BW, findEitherByteAVX512BW };
+
+    switch (instruction_set)
+    {
+      case Kernels::InstructionSet::SSE41:
+        return &SSE41;
+      case Kernels::InstructionSet::AVX2:
+        return &AVX2;
+      case Kernels::InstructionSet::AVX512BW:
+        return &AVX512BW;
+      default:
+        break;
+    }
+#endif
+    return &Scalar;
+  }
+
+  std::atomic<KernelTable const*>& activeKernels()
+  {
+    static std::atomic<KernelTable const*> active = []
+    {
+      for (auto instruction_set : { Kernels::InstructionSet::AVX512BW, Kernels::InstructionSet::AVX2, Kernels::InstructionSet::SSE41 })
+      {
+        if (cpuSupports(instruction_set))
+          return kernelTable(instruction_set);
+      }
+
+      return kernelTable(Kernels::InstructionSet::SCALAR);
+    }();
+
+    return active;
+  }
+}
+
+void Kernels::normalizeText(char* data, std::size_t size)
+{
+  activeKernels().load(std::memory_order_relaxed)->normalize_text(data, size);
+}
+
+std::size_t Kernels::countByte(char const* data, std::size_t size, char value)
+{
+  return activeKernels().load(std::memory_order_relaxed)->count_byte(data, size, value);
+}
+
+char* Kernels::findEitherByte(char* begin, char* end, char first, char second)
+{
+  return activeKernels().load(std::memory_order_relaxed)->find_either_byte(begin, end, first, second);
+}
+
+Kernels::InstructionSet Kernels::activeInstructionSet()
+{
+  return activeKernels().load(std::memory_order_relaxed)->instruction_set;
+}
+
+bool Kernels::isSupported(InstructionSet instruction_set)
+{
+  return cpuSupports(instruction_set);
+}
+
+bool Kernels::forceInstructionSet(InstructionSet instruction_set)
+{
+  if (!cpuSupports(instruction_set))
+    return false;
+
+  activeKernels().store(kernelTable(instruction_set), std::memory_order_relaxed);
+  return true;
+}
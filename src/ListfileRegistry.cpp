@@ -0,0 +1,93 @@
+#include <ListfileRegistry.hpp>
+#include <Exception.hpp>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+using namespace BlizzardArchive::Listfile;
+
+ListfileRegistry& ListfileRegistry::instance()
+{
+  static ListfileRegistry registry;
+  return registry;
+}
+
+std::string ListfileRegistry::identityOf(std::string const& path)
+{
+  std::error_code ec;
+  fs::path const canonical = fs::canonical(path, ec);
+
+  if (ec)
+    return {};
+
+  std::uintmax_t const size = fs::file_size(canonical, ec);
+  if (ec)
+    return {};
+
+  auto const last_write_time = fs::last_write_time(canonical, ec);
+  if (ec)
+    return {};
+
+  return canonical.string() + '|' + std::to_string(size) + '|' + std::to_string(last_write_time.time_since_epoch().count());
+}
+
+template<typename Loader>
+std::shared_ptr<Listfile const> ListfileRegistry::acquire(std::string const& path, Loader&& loader)
+{
+  std::string const identity = identityOf(path);
+
+  if (identity.empty())
+    throw Exceptions::Listfile::ListfileNotFoundError();
+
+  const std::lock_guard _lock(_mutex);
+
+  std::erase_if(_listfiles, [](auto const& entry) { return entry.second.expired(); });
+
+  auto it = _listfiles.find(identity);
+  if (it != _listfiles.end())
+  {
+    if (std::shared_ptr<Listfile const> listfile = it->second.lock())
+      return listfile;
+  }
+
+  // Loading only starts a background parse or maps a file, holding the lock meanwhile is cheap.
+  auto listfile = std::make_shared<Listfile>();
+  loader(*listfile, path);
+
+  std::shared_ptr<Listfile const> shared = std::move(listfile);
+  _listfiles[identity] = shared;
+  return shared;
+}
+
+std::shared_ptr<Listfile const> ListfileRegistry::acquireCSV(std::string const& csv_path)
+{
+  return acquire(csv_path, [](Listfile& listfile, std::string const& path) { listfile.initFromCSVAsync(path); });
+}
+
+std::shared_ptr<Listfile const> ListfileRegistry::acquireBinary(std::string const& binary_path)
+{
+  return acquire(binary_path, [](Listfile& listfile, std::string const& path) { listfile.initFromBinary(path); });
+}
+
+std::shared_ptr<Listfile const> ListfileRegistry::acquire(std::string const& directory, bool use_binary)
+{
+  fs::path const csv_path = fs::path(directory) / "listfile.csv";
+  fs::path const binary_path = fs::path(directory) / "listfile.bin";
+
+  // A compiled listfile is mapped instead of parsing the CSV, unless the CSV was updated after it was built.
+  std::error_code ec;
+
+  if (use_binary && fs::exists(binary_path, ec)
+    && (!fs::exists(csv_path, ec) || fs::last_write_time(binary_path, ec) >= fs::last_write_time(csv_path, ec)))
+  {
+    try
+    {
+      return acquireBinary(binary_path.string());
+    }
+    catch (std::runtime_error const&)
+    {
+      // Corrupted or from another format version, fall back to the CSV.
+    }
+  }
+
+  return acquireCSV(csv_path.string());
+}
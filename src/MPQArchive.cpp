@@ -1,6 +1,8 @@
 #include <MPQArchive.hpp>
 #include <Exception.hpp>
 #include <StormLib.h>
+#include <algorithm>
+#include <cstring>
 
 
 using namespace BlizzardArchive::Archive;
@@ -13,24 +15,277 @@ MPQArchive::MPQArchive(std::string const& path, Locale locale, Listfile::Listfil
     throw Exceptions::Archive::ArchiveOpenError("Error opening archive: " + path);
   }
 
+  loadHashTable();
+
   // handle listfiles
   HANDLE fh;
   if (SFileOpenFileEx(_handle, "(listfile)", 0, &fh))
   {
-    size_t filesize = SFileGetFileSize(fh, nullptr); 
-
-    char* readbuffer = (char*)malloc(filesize);
-    SFileReadFile(fh, readbuffer, filesize, nullptr, nullptr);
+    std::string contents(SFileGetFileSize(fh, nullptr), '\0');
+    SFileReadFile(fh, contents.data(), static_cast<DWORD>(contents.size()), nullptr, nullptr);
     SFileCloseFile(fh);
-    
-    listfile->initFromFileList(readbuffer, filesize);
+
+    _names = listfile->ingestFileList(std::move(contents));
+  }
+
+  _names_complete = !_names.empty() && listfileCoversHashTable();
+}
+
+bool MPQArchive::listfileCoversHashTable() const
+{
+  // Without a classic hash table there is nothing to check the names against.
+  if (_hash_table.empty())
+    return false;
+
+  std::size_t const mask = _hash_table.size() - 1;
+  std::vector<bool> covered(_hash_table.size());
+
+  auto cover = [&](std::string_view name)
+  {
+    MPQNameHash const name_hash = hashMPQName(name);
+    std::size_t const start = name_hash.table_index & mask;
+
+    // Every locale of the name is covered.
+    for (std::size_t index = start;;)
+    {
+      HashEntry const& entry = _hash_table[index];
+
+      if (entry.block_index == HASH_ENTRY_FREE)
+        break;
+
+      if (entry.name_a == name_hash.name_a && entry.name_b == name_hash.name_b)
+        covered[index] = true;
+
+      index = (index + 1) & mask;
+      if (index == start)
+        break;
+    }
+  };
+
+  for (std::string_view name : { "(listfile)", "(attributes)", "(signature)", "(patch_metadata)" })
+  {
+    cover(name);
+  }
+
+  for (std::string_view name : _names)
+  {
+    cover(name);
   }
-  
+
+  for (std::size_t index = 0; index < _hash_table.size(); ++index)
+  {
+    std::uint32_t const block_index = _hash_table[index].block_index;
+
+    if (covered[index] || block_index == HASH_ENTRY_FREE || block_index == HASH_ENTRY_DELETED)
+      continue;
+
+    // Entries of deleted files do not matter, anything else is a file missing from the (listfile).
+    if (block_index >= _block_flags.size()
+      || ((_block_flags[block_index] & MPQ_FILE_EXISTS) && !(_block_flags[block_index] & MPQ_FILE_DELETE_MARKER)))
+      return false;
+  }
+
+  return true;
+}
+
+bool MPQArchive::openPatchArchive(std::string const& path, std::string const& prefix)
+{
+  if (!SFileOpenPatchArchive(_handle, path.c_str(), prefix.c_str(), 0))
+    return false;
+
+  _patches.emplace_back(path, prefix);
+  return true;
+}
+
+void MPQArchive::loadHashTable()
+{
+  static_assert(sizeof(HashEntry) == 16 && sizeof(BlockEntry) == 16);
+
+  // MPQs with only HET/BET tables have no classic hash table, lookups go through StormLib then.
+  DWORD hash_table_size = 0;
+  if (!SFileGetFileInfo(_handle, SFileMpqHashTableSize, &hash_table_size, sizeof(hash_table_size), nullptr)
+    || !hash_table_size || (hash_table_size & (hash_table_size - 1)))
+    return;
+
+  _hash_table.resize(hash_table_size);
+  if (!SFileGetFileInfo(_handle, SFileMpqHashTable, _hash_table.data(), hash_table_size * sizeof(HashEntry), nullptr))
+  {
+    _hash_table.clear();
+    return;
+  }
+
+  DWORD block_table_size = 0;
+  if (!SFileGetFileInfo(_handle, SFileMpqBlockTableSize, &block_table_size, sizeof(block_table_size), nullptr)
+    || !block_table_size)
+    return;
+
+  std::vector<BlockEntry> blocks(block_table_size);
+  if (!SFileGetFileInfo(_handle, SFileMpqBlockTable, blocks.data(), block_table_size * sizeof(BlockEntry), nullptr))
+    return;
+
+  ULONGLONG header_offset = 0;
+  if (!SFileGetFileInfo(_handle, SFileMpqHeaderOffset, &header_offset, sizeof(header_offset), nullptr))
+    return;
+
+  // Archives above 4 GiB keep the high 16 bits of the block positions in a separate table.
+  std::vector<std::uint16_t> high_positions;
+  ULONGLONG high_table_offset = 0;
+
+  if (SFileGetFileInfo(_handle, SFileMpqHiBlockTableOffset, &high_table_offset, sizeof(high_table_offset), nullptr)
+    && high_table_offset)
+  {
+    high_positions.resize(blocks.size());
+
+    if (!SFileGetFileInfo(_handle, SFileMpqHiBlockTable, high_positions.data()
+      , static_cast<DWORD>(high_positions.size() * sizeof(std::uint16_t)), nullptr))
+      return;
+  }
+
+  _block_flags.reserve(blocks.size());
+  _block_positions.reserve(blocks.size());
+  for (std::size_t i = 0; i < blocks.size(); ++i)
+  {
+    std::uint64_t const high = high_positions.empty() ? 0 : std::uint64_t(high_positions[i]) << 32;
+    _block_flags.push_back(blocks[i].flags);
+    _block_positions.push_back(header_offset + (high | blocks[i].file_position));
+  }
+
+#ifdef BLIZZARD_ARCHIVE_NATIVE_MPQ
+  loadNativeReader(blocks, header_offset);
+#endif
+}
+
+#ifdef BLIZZARD_ARCHIVE_NATIVE_MPQ
+void MPQArchive::loadNativeReader(std::vector<BlockEntry> const& blocks, std::uint64_t header_offset)
+{
+  DWORD sector_size = 0;
+
+  if (!SFileGetFileInfo(_handle, SFileMpqSectorSize, &sector_size, sizeof(sector_size), nullptr) || !sector_size)
+    return;
+
+  SharedBuffer archive = SharedBuffer::mapFile(_path);
+  if (!archive)
+    return;
+
+  std::vector<NativeMPQReader::Block> native_blocks;
+  native_blocks.reserve(blocks.size());
+
+  for (std::size_t i = 0; i < blocks.size(); ++i)
+  {
+    // Positions in the reader are relative to the header.
+    native_blocks.push_back({ _block_positions[i] - header_offset, blocks[i].compressed_size, blocks[i].file_size, blocks[i].flags });
+  }
+
+  _native_reader = std::make_unique<NativeMPQReader>(std::move(archive), header_offset, sector_size, std::move(native_blocks));
+}
+#endif
+
+MPQArchive::HashLookup MPQArchive::lookupHashTable(MPQNameHash const& name_hash, std::uint32_t* block_index) const
+{
+  // Patches can add files missing from the base archive's own table.
+  if (_hash_table.empty() || !_patches.empty())
+    return HashLookup::UNKNOWN;
+
+  std::size_t const mask = _hash_table.size() - 1;
+  std::size_t const start = name_hash.table_index & mask;
+  bool localized = false;
+  std::uint32_t neutral_block = HASH_ENTRY_FREE;
+
+  for (std::size_t index = start;;)
+  {
+    HashEntry const& entry = _hash_table[index];
+
+    if (entry.block_index == HASH_ENTRY_FREE)
+      break;
+
+    if (entry.name_a == name_hash.name_a && entry.name_b == name_hash.name_b && entry.block_index != HASH_ENTRY_DELETED)
+    {
+      if (entry.block_index >= _block_flags.size())
+      {
+        // Block beyond the classic block table, let StormLib resolve it.
+        localized = true;
+      }
+      else if ((_block_flags[entry.block_index] & MPQ_FILE_EXISTS) && !(_block_flags[entry.block_index] & MPQ_FILE_DELETE_MARKER))
+      {
+        // StormLib opens the neutral locale by default, and the last such entry when there are several.
+        if (!entry.locale && !entry.platform)
+          neutral_block = entry.block_index;
+        else
+          localized = true;
+      }
+    }
+
+    index = (index + 1) & mask;
+    if (index == start)
+      break;
+  }
+
+  if (neutral_block != HASH_ENTRY_FREE)
+  {
+    if (block_index)
+      *block_index = neutral_block;
+
+    return HashLookup::PRESENT;
+  }
+
+  return localized ? HashLookup::UNKNOWN : HashLookup::ABSENT;
+}
+
+MPQArchive::HashLookup MPQArchive::lookupHashTable(Listfile::FileKey const& file_key, std::uint32_t* block_index) const
+{
+  // MPQs only know files by name, a key without a path is never found here.
+  if (!file_key.hasFilepath())
+    return HashLookup::ABSENT;
+
+  if (_hash_table.empty() || !_patches.empty())
+    return HashLookup::UNKNOWN;
+
+  return lookupHashTable(file_key.mpqHash(), block_index);
+}
+
+HANDLE MPQArchive::acquireHandle() const
+{
+  {
+    const std::lock_guard _lock(_pool_mutex);
+
+    if (!_idle_handles.empty())
+    {
+      HANDLE handle = _idle_handles.back();
+      _idle_handles.pop_back();
+      return handle;
+    }
+  }
+
+  HANDLE handle = nullptr;
+  if (!SFileOpenArchive(_path.c_str(), 0, MPQ_OPEN_NO_LISTFILE | STREAM_FLAG_READ_ONLY, &handle))
+  {
+    throw Exceptions::Archive::ArchiveOpenError("Error opening archive: " + _path);
+  }
+
+  // A handle missing a patch would serve unpatched data while the others serve patched data.
+  for (auto const& [patch_path, prefix] : _patches)
+  {
+    if (!SFileOpenPatchArchive(handle, patch_path.c_str(), prefix.c_str(), 0))
+    {
+      SFileCloseArchive(handle);
+      throw Exceptions::Archive::ArchiveOpenError("Error applying patch archive " + patch_path + " to: " + _path);
+    }
+  }
+
+  return handle;
+}
+
+void MPQArchive::releaseHandle(HANDLE handle) const
+{
+  const std::lock_guard _lock(_pool_mutex);
+  _idle_handles.push_back(handle);
 }
 
 bool MPQArchive::openFile(Listfile::FileKey const& file_key, Locale locale, HANDLE* file_handle) const
 {
-  assert(file_key.hasFilepath());
+  if (lookupHashTable(file_key) == HashLookup::ABSENT)
+    return false;
+
   return SFileOpenFileEx(_handle, ClientData::normalizeFilenameWoW(file_key.filepath()).c_str(), 0, file_handle);
 }
 
@@ -54,12 +309,188 @@ std::uint64_t MPQArchive::getFileSize(HANDLE file_handle) const
 
 bool MPQArchive::exists(Listfile::FileKey const& file_key, Locale locale) const
 {
-  assert(file_key.hasFilepath());
-  return SFileHasFile(_handle, ClientData::normalizeFilenameWoW(file_key.filepath()).c_str());
+  switch (lookupHashTable(file_key))
+  {
+    case HashLookup::ABSENT:
+      return false;
+    case HashLookup::PRESENT:
+      return true;
+    case HashLookup::UNKNOWN:
+      break;
+  }
+
+  HANDLE archive_handle = acquireHandle();
+  bool status = SFileHasFile(archive_handle, ClientData::normalizeFilenameWoW(file_key.filepath()).c_str());
+  releaseHandle(archive_handle);
+
+  return status;
+}
+
+bool MPQArchive::readFile(Listfile::FileKey const& file_key, Locale locale, std::vector<char>& buffer) const
+{
+  if (lookupHashTable(file_key) == HashLookup::ABSENT)
+    return false;
+
+#ifdef BLIZZARD_ARCHIVE_NATIVE_MPQ
+  // Failures fall through to StormLib too, it has the final word on what the archive contains.
+  if (readFileNative(file_key, buffer) == NativeMPQReader::ReadResult::OK)
+    return true;
+#endif
+
+  HANDLE archive_handle = acquireHandle();
+  HANDLE file_handle = nullptr;
+
+  bool status = SFileOpenFileEx(archive_handle, ClientData::normalizeFilenameWoW(file_key.filepath()).c_str(), 0, &file_handle);
+
+  if (status)
+  {
+    DWORD file_size = SFileGetFileSize(file_handle, nullptr);
+    buffer.resize(file_size);
+
+    status = SFileReadFile(file_handle, buffer.data(), file_size, nullptr, nullptr);
+    SFileCloseFile(file_handle);
+  }
+
+  releaseHandle(archive_handle);
+  return status;
+}
+
+#ifdef BLIZZARD_ARCHIVE_NATIVE_MPQ
+NativeMPQReader::ReadResult MPQArchive::readFileNative(Listfile::FileKey const& file_key, std::vector<char>& buffer) const
+{
+  if (!_native_reader)
+    return NativeMPQReader::ReadResult::UNSUPPORTED;
+
+  std::uint32_t block_index = HASH_ENTRY_FREE;
+  switch (lookupHashTable(file_key, &block_index))
+  {
+    case HashLookup::ABSENT:
+      return NativeMPQReader::ReadResult::FAILED;
+    case HashLookup::UNKNOWN:
+      return NativeMPQReader::ReadResult::UNSUPPORTED;
+    case HashLookup::PRESENT:
+      break;
+  }
+
+  return _native_reader->read(block_index, ClientData::normalizeFilenameWoW(file_key.filepath()), buffer);
+}
+#endif
+
+std::optional<std::uint64_t> MPQArchive::getFileOffset(Listfile::FileKey const& file_key, Locale locale) const
+{
+  std::uint32_t block_index = 0;
+
+  switch (lookupHashTable(file_key, &block_index))
+  {
+    case HashLookup::ABSENT:
+      return std::nullopt;
+    case HashLookup::PRESENT:
+      return _block_positions[block_index];
+    case HashLookup::UNKNOWN:
+      break;
+  }
+
+  HANDLE archive_handle = acquireHandle();
+  HANDLE file_handle = nullptr;
+  std::optional<std::uint64_t> offset;
+
+  if (SFileOpenFileEx(archive_handle, ClientData::normalizeFilenameWoW(file_key.filepath()).c_str(), 0, &file_handle))
+  {
+    ULONGLONG byte_offset = 0;
+    SFileGetFileInfo(file_handle, SFileInfoByteOffset, &byte_offset, sizeof(byte_offset), nullptr);
+    SFileCloseFile(file_handle);
+
+    offset = byte_offset;
+  }
+
+  releaseHandle(archive_handle);
+  return offset;
+}
+
+bool MPQArchive::forEachFile(std::function<void(std::string const&)> const& callback) const
+{
+  // Names of files in patched archives come from the whole patch chain, a single (listfile) does not cover them.
+  // Files missing from the (listfile) would be unreachable through the index, or lose an override to an older archive.
+  if (!_patches.empty() || !_names_complete)
+    return false;
+
+  HANDLE archive_handle = nullptr;
+
+  for (std::string_view name : _names)
+  {
+    // (listfile) may name files that were deleted from the archive later on.
+    HashLookup lookup = lookupHashTable(hashMPQName(name));
+
+    if (lookup == HashLookup::UNKNOWN)
+    {
+      if (!archive_handle)
+        archive_handle = acquireHandle();
+
+      lookup = SFileHasFile(archive_handle, std::string(name).c_str()) ? HashLookup::PRESENT : HashLookup::ABSENT;
+    }
+
+    if (lookup == HashLookup::PRESENT)
+      callback(ClientData::normalizeFilenameInternal(std::string(name)));
+  }
+
+  if (archive_handle)
+    releaseHandle(archive_handle);
+
+  return true;
+}
+
+bool MPQArchive::forEachManifestEntry(std::function<void(ManifestEntry&&)> const& callback) const
+{
+  // The entries of a patched archive describe the base files, not what reading them returns.
+  if (!_patches.empty() || !_names_complete)
+    return false;
+
+  HANDLE archive_handle = acquireHandle();
+
+  for (std::string_view name : _names)
+  {
+    if (lookupHashTable(hashMPQName(name)) == HashLookup::ABSENT)
+      continue;
+
+    HANDLE file_handle = nullptr;
+    if (!SFileOpenFileEx(archive_handle, std::string(name).c_str(), SFILE_OPEN_FROM_MPQ, &file_handle))
+      continue;
+
+    // Opening only reads the tables, StormLib fills the checksums in from (attributes) if the archive has one.
+    TFileEntry file_entry {};
+    bool const status = SFileGetFileInfo(file_handle, SFileInfoFileEntry, &file_entry, sizeof(file_entry), nullptr);
+    SFileCloseFile(file_handle);
+
+    if (!status)
+      continue;
+
+    ManifestEntry entry;
+    entry.path = ClientData::normalizeFilenameInternal(std::string(name));
+    entry.size = file_entry.dwFileSize;
+
+    if (std::any_of(std::begin(file_entry.md5), std::end(file_entry.md5), [](BYTE byte) { return byte != 0; }))
+    {
+      entry.hash_type = ManifestHashType::MD5;
+      std::memcpy(entry.hash.data(), file_entry.md5, entry.hash.size());
+    }
+    else if (file_entry.dwCrc32)
+    {
+      entry.hash_type = ManifestHashType::CRC32;
+      std::memcpy(entry.hash.data(), &file_entry.dwCrc32, sizeof(file_entry.dwCrc32));
+    }
+
+    callback(std::move(entry));
+  }
+
+  releaseHandle(archive_handle);
+  return true;
 }
 
 MPQArchive::~MPQArchive()
 {
+  for (HANDLE handle : _idle_handles)
+    SFileCloseArchive(handle);
+
   if (_handle)
     SFileCloseArchive(_handle);
 }
\ No newline at end of file
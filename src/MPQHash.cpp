@@ -0,0 +1,114 @@
+#include <MPQHash.hpp>
+#include <array>
+#include <cstring>
+
+using namespace BlizzardArchive::Archive;
+
+namespace
+{
+  constexpr std::uint32_t HashTableIndex = 0x000;
+  constexpr std::uint32_t HashNameA = 0x100;
+  constexpr std::uint32_t HashNameB = 0x200;
+  constexpr std::uint32_t HashFileKey = 0x300;
+  constexpr std::uint32_t DecryptKey = 0x400;
+
+  constexpr std::array<std::uint32_t, 0x500> makeCryptTable()
+  {
+    std::array<std::uint32_t, 0x500> table = {};
+    std::uint32_t seed = 0x00100001;
+
+    for (std::uint32_t index1 = 0; index1 < 0x100; ++index1)
+    {
+      for (std::uint32_t index2 = index1, i = 0; i < 5; ++i, index2 += 0x100)
+      {
+        seed = (seed * 125 + 3) % 0x2AAAAB;
+        std::uint32_t const high = (seed & 0xFFFF) << 0x10;
+
+        seed = (seed * 125 + 3) % 0x2AAAAB;
+        std::uint32_t const low = seed & 0xFFFF;
+
+        table[index2] = high | low;
+      }
+    }
+
+    return table;
+  }
+
+  constexpr std::array<std::uint8_t, 0x100> makeUpperTable()
+  {
+    std::array<std::uint8_t, 0x100> table = {};
+
+    for (std::uint32_t c = 0; c < 0x100; ++c)
+    {
+      table[c] = c >= 'a' && c <= 'z' ? static_cast<std::uint8_t>(c - 'a' + 'A')
+        : c == '/' ? static_cast<std::uint8_t>('\\') : static_cast<std::uint8_t>(c);
+    }
+
+    return table;
+  }
+
+  constexpr std::array<std::uint32_t, 0x500> CryptTable = makeCryptTable();
+  constexpr std::array<std::uint8_t, 0x100> UpperTable = makeUpperTable();
+}
+
+MPQNameHash BlizzardArchive::Archive::hashMPQName(std::string_view name)
+{
+  // All three hashes in one pass over the name.
+  std::uint32_t seeds1[3] = { 0x7FED7FED, 0x7FED7FED, 0x7FED7FED };
+  std::uint32_t seeds2[3] = { 0xEEEEEEEE, 0xEEEEEEEE, 0xEEEEEEEE };
+  constexpr std::uint32_t types[3] = { HashTableIndex, HashNameA, HashNameB };
+
+  for (char c : name)
+  {
+    std::uint32_t const upper = UpperTable[static_cast<std::uint8_t>(c)];
+
+    for (int i = 0; i < 3; ++i)
+    {
+      seeds1[i] = CryptTable[types[i] + upper] ^ (seeds1[i] + seeds2[i]);
+      seeds2[i] = upper + seeds1[i] + seeds2[i] + (seeds2[i] << 5) + 3;
+    }
+  }
+
+  return { seeds1[0], seeds1[1], seeds1[2] };
+}
+
+std::uint32_t BlizzardArchive::Archive::mpqFileKey(std::string_view name)
+{
+  std::size_t const separator = name.find_last_of("\\/");
+  if (separator != std::string_view::npos)
+    name.remove_prefix(separator + 1);
+
+  std::uint32_t seed1 = 0x7FED7FED;
+  std::uint32_t seed2 = 0xEEEEEEEE;
+
+  for (char c : name)
+  {
+    std::uint32_t const upper = UpperTable[static_cast<std::uint8_t>(c)];
+
+    seed1 = CryptTable[HashFileKey + upper] ^ (seed1 + seed2);
+    seed2 = upper + seed1 + seed2 + (seed2 << 5) + 3;
+  }
+
+  return seed1;
+}
+
+void BlizzardArchive::Archive::decryptMPQData(void* data, std::size_t size, std::uint32_t key)
+{
+  char* const bytes = static_cast<char*>(data);
+  std::uint32_t seed = 0xEEEEEEEE;
+
+  // Sector data has no alignment guarantee, words are copied in and out.
+  for (std::size_t offset = 0; offset + sizeof(std::uint32_t) <= size; offset += sizeof(std::uint32_t))
+  {
+    std::uint32_t word;
+    std::memcpy(&word, bytes + offset, sizeof(word));
+
+    seed += CryptTable[DecryptKey + (key & 0xFF)];
+    word ^= key + seed;
+
+    key = ((~key << 0x15) + 0x11111111) | (key >> 0x0B);
+    seed = word + seed + (seed << 5) + 3;
+
+    std::memcpy(bytes + offset, &word, sizeof(word));
+  }
+}
@@ -0,0 +1,146 @@
+#include <Manifest.hpp>
+#include <FileReplace.hpp>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <tuple>
+
+using namespace BlizzardArchive;
+
+namespace
+{
+  bool keyLess(ManifestEntry const& lhs, ManifestEntry const& rhs)
+  {
+    return std::tie(lhs.file_data_id, lhs.path) < std::tie(rhs.file_data_id, rhs.path);
+  }
+
+  bool sameContents(ManifestEntry const& lhs, ManifestEntry const& rhs)
+  {
+    return lhs.hash_type != ManifestHashType::NONE && lhs.hash_type == rhs.hash_type
+      && lhs.size == rhs.size && lhs.hash == rhs.hash;
+  }
+
+  template<typename T>
+  void writeValue(std::ostream& stream, T const& value)
+  {
+    stream.write(reinterpret_cast<char const*>(&value), sizeof(value));
+  }
+
+  template<typename T>
+  bool readValue(std::ifstream& stream, T& value)
+  {
+    return static_cast<bool>(stream.read(reinterpret_cast<char*>(&value), sizeof(value)));
+  }
+}
+
+Listfile::FileKey ManifestEntry::fileKey() const
+{
+  return file_data_id ? Listfile::FileKey(file_data_id) : Listfile::FileKey(path);
+}
+
+Manifest::Manifest(std::vector<ManifestEntry> entries)
+: _entries(std::move(entries))
+{
+  std::stable_sort(_entries.begin(), _entries.end(), keyLess);
+
+  // Keep the last entry of every run of equal keys.
+  std::size_t unique_count = 0;
+  for (std::size_t i = 0; i < _entries.size(); ++i)
+  {
+    if (i + 1 < _entries.size() && !keyLess(_entries[i], _entries[i + 1]))
+      continue;
+
+    if (unique_count != i)
+      _entries[unique_count] = std::move(_entries[i]);
+
+    ++unique_count;
+  }
+
+  _entries.resize(unique_count);
+}
+
+void Manifest::save(std::string const& path) const
+{
+  bool const saved = replaceFile(path, [&](std::ostream& stream)
+  {
+    stream.write(Magic, sizeof(Magic));
+    writeValue(stream, static_cast<std::uint64_t>(_entries.size()));
+
+    for (auto const& entry : _entries)
+    {
+      writeValue(stream, entry.file_data_id);
+      writeValue(stream, entry.size);
+      writeValue(stream, entry.hash_type);
+      writeValue(stream, entry.hash);
+      writeValue(stream, static_cast<std::uint32_t>(entry.path.size()));
+      stream.write(entry.path.data(), entry.path.size());
+    }
+  });
+
+  if (!saved)
+    throw std::runtime_error("Failed to write manifest.");
+}
+
+void Manifest::load(std::string const& path)
+{
+  std::ifstream stream {path, std::ios_base::binary | std::ios_base::in};
+
+  char magic[sizeof(Magic)];
+  std::uint64_t count = 0;
+
+  if (!stream.read(magic, sizeof(magic)) || std::memcmp(magic, Magic, sizeof(Magic)) || !readValue(stream, count))
+    throw std::runtime_error("Not a manifest: " + path);
+
+  std::vector<ManifestEntry> entries;
+  for (std::uint64_t i = 0; i < count; ++i)
+  {
+    ManifestEntry entry;
+    std::uint32_t path_size = 0;
+
+    if (!readValue(stream, entry.file_data_id) || !readValue(stream, entry.size) || !readValue(stream, entry.hash_type)
+      || !readValue(stream, entry.hash) || !readValue(stream, path_size))
+      throw std::runtime_error("Truncated manifest: " + path);
+
+    entry.path.resize(path_size);
+    if (!stream.read(entry.path.data(), path_size))
+      throw std::runtime_error("Truncated manifest: " + path);
+
+    entries.push_back(std::move(entry));
+  }
+
+  // Entries were saved sorted and unique, this only guards against hand-edited files.
+  *this = Manifest(std::move(entries));
+}
+
+ManifestDiff Manifest::diff(Manifest const& newer) const
+{
+  ManifestDiff result;
+
+  auto old_it = _entries.begin();
+  auto new_it = newer._entries.begin();
+
+  while (old_it != _entries.end() || new_it != newer._entries.end())
+  {
+    if (new_it == newer._entries.end() || (old_it != _entries.end() && keyLess(*old_it, *new_it)))
+    {
+      result.removed.push_back(old_it->fileKey());
+      ++old_it;
+    }
+    else if (old_it == _entries.end() || keyLess(*new_it, *old_it))
+    {
+      result.added.push_back(new_it->fileKey());
+      ++new_it;
+    }
+    else
+    {
+      if (!sameContents(*old_it, *new_it))
+        result.changed.push_back(new_it->fileKey());
+
+      ++old_it;
+      ++new_it;
+    }
+  }
+
+  return result;
+}
@@ -0,0 +1,189 @@
+#ifdef BLIZZARD_ARCHIVE_NATIVE_MPQ
+
+#include <NativeMPQReader.hpp>
+#include <IOExecutor.hpp>
+#include <MPQHash.hpp>
+#include <StormLib.h>
+#include <zlib.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <latch>
+
+using namespace BlizzardArchive::Archive;
+
+namespace
+{
+  constexpr std::uint8_t CompressionZlib = 0x02;
+}
+
+NativeMPQReader::NativeMPQReader(SharedBuffer archive, std::uint64_t header_offset, std::uint32_t sector_size, std::vector<Block> blocks)
+: _archive(std::move(archive))
+, _header_offset(header_offset)
+, _sector_size(sector_size)
+, _blocks(std::move(blocks))
+{
+}
+
+NativeMPQReader::ReadResult NativeMPQReader::readSector(Block const& block, char const* data, std::size_t stored_size
+  , char* output, std::size_t output_size, std::uint32_t key, std::vector<char>& scratch) const
+{
+  char const* source = data;
+
+  if (block.flags & MPQ_FILE_ENCRYPTED)
+  {
+    scratch.assign(data, data + stored_size);
+    decryptMPQData(scratch.data(), stored_size, key);
+    source = scratch.data();
+  }
+
+  // Sectors that would not shrink are stored as they are, even in compressed files.
+  if (stored_size == output_size)
+  {
+    std::memcpy(output, source, output_size);
+    return ReadResult::OK;
+  }
+
+  if (!(block.flags & MPQ_FILE_COMPRESS) || !stored_size || stored_size > output_size)
+    return ReadResult::FAILED;
+
+  // The first byte lists the compressions applied, only plain zlib is handled here.
+  if (static_cast<std::uint8_t>(source[0]) != CompressionZlib)
+    return ReadResult::UNSUPPORTED;
+
+  uLongf decompressed_size = static_cast<uLongf>(output_size);
+  if (uncompress(reinterpret_cast<Bytef*>(output), &decompressed_size
+    , reinterpret_cast<Bytef const*>(source + 1), static_cast<uLong>(stored_size - 1)) != Z_OK
+    || decompressed_size != output_size)
+    return ReadResult::FAILED;
+
+  return ReadResult::OK;
+}
+
+NativeMPQReader::ReadResult NativeMPQReader::read(std::uint32_t block_index, std::string_view name, std::vector<char>& buffer) const
+{
+  if (block_index >= _blocks.size())
+    return ReadResult::FAILED;
+
+  Block const& block = _blocks[block_index];
+
+  if (!(block.flags & MPQ_FILE_EXISTS) || (block.flags & MPQ_FILE_DELETE_MARKER))
+    return ReadResult::FAILED;
+
+  if (block.flags & (MPQ_FILE_IMPLODE | MPQ_FILE_PATCH_FILE))
+    return ReadResult::UNSUPPORTED;
+
+  std::uint64_t const begin = _header_offset + block.offset;
+  if (begin > _archive.size() || block.compressed_size > _archive.size() - begin)
+    return ReadResult::FAILED;
+
+  char const* const data = _archive.data() + begin;
+  buffer.resize(block.file_size);
+
+  if (!block.file_size)
+    return ReadResult::OK;
+
+  std::uint32_t key = 0;
+  if (block.flags & MPQ_FILE_ENCRYPTED)
+  {
+    key = mpqFileKey(name);
+
+    if (block.flags & MPQ_FILE_FIX_KEY)
+      key = (key + static_cast<std::uint32_t>(block.offset)) ^ block.file_size;
+  }
+
+  if (block.flags & MPQ_FILE_SINGLE_UNIT)
+  {
+    std::vector<char> scratch;
+    return readSector(block, data, block.compressed_size, buffer.data(), block.file_size, key, scratch);
+  }
+
+  std::size_t const sector_count = (std::size_t(block.file_size) + _sector_size - 1) / _sector_size;
+  std::vector<std::uint32_t> offsets(sector_count + 1);
+
+  if (block.flags & MPQ_FILE_COMPRESS)
+  {
+    // Sector offset table, with one more entry for the sector checksums if there are any.
+    std::size_t const table_size = (sector_count + 1 + ((block.flags & MPQ_FILE_SECTOR_CRC) ? 1 : 0)) * sizeof(std::uint32_t);
+    if (table_size > block.compressed_size)
+      return ReadResult::FAILED;
+
+    std::vector<std::uint32_t> table(table_size / sizeof(std::uint32_t));
+    std::memcpy(table.data(), data, table_size);
+
+    if (block.flags & MPQ_FILE_ENCRYPTED)
+      decryptMPQData(table.data(), table_size, key - 1);
+
+    std::copy_n(table.begin(), offsets.size(), offsets.begin());
+
+    // StormLib works around some malformed tables, leave those to it.
+    if (offsets.front() != table_size || offsets.back() > block.compressed_size
+      || !std::is_sorted(offsets.begin(), offsets.end()))
+      return ReadResult::UNSUPPORTED;
+  }
+  else
+  {
+    if (block.compressed_size < block.file_size)
+      return ReadResult::FAILED;
+
+    for (std::size_t i = 0; i <= sector_count; ++i)
+    {
+      offsets[i] = static_cast<std::uint32_t>(std::min<std::size_t>(i * _sector_size, block.file_size));
+    }
+  }
+
+  // Tasks write disjoint parts of the buffer, the worst result of any sector is the result of the read.
+  std::atomic<int> result = static_cast<int>(ReadResult::OK);
+
+  auto readSectors = [&](std::size_t first, std::size_t last)
+  {
+    std::vector<char> scratch;
+
+    for (std::size_t i = first; i < last && result.load(std::memory_order_relaxed) == static_cast<int>(ReadResult::OK); ++i)
+    {
+      std::size_t const output_offset = i * _sector_size;
+      std::size_t const output_size = std::min<std::size_t>(_sector_size, block.file_size - output_offset);
+
+      ReadResult const sector_result = readSector(block, data + offsets[i], offsets[i + 1] - offsets[i]
+        , buffer.data() + output_offset, output_size, key + static_cast<std::uint32_t>(i), scratch);
+
+      if (sector_result != ReadResult::OK)
+      {
+        int expected = static_cast<int>(ReadResult::OK);
+        result.compare_exchange_strong(expected, static_cast<int>(sector_result));
+      }
+    }
+  };
+
+  // Ranges go to the shared I/O pool and the calling thread reads the first one. A read already running
+  // on that pool stays inline, waiting on requests queued behind it could exhaust the workers.
+  IOExecutor* const executor = IOExecutor::instance();
+
+  std::size_t const task_count = sector_count < ParallelSectorThreshold || executor->isWorkerThread() ? 1
+    : std::min<std::size_t>(executor->workerCount() + 1, sector_count / SectorsPerTask);
+
+  if (task_count <= 1)
+  {
+    readSectors(0, sector_count);
+  }
+  else
+  {
+    std::size_t const range_size = (sector_count + task_count - 1) / task_count;
+    std::size_t const queued_count = (sector_count - 1) / range_size;
+
+    std::latch done(static_cast<std::ptrdiff_t>(queued_count));
+    for (std::size_t first = range_size; first < sector_count; first += range_size)
+    {
+      // Cancelled requests still run on a worker, the buffer is only valid until this read returns.
+      auto task = [&, first] { readSectors(first, std::min(first + range_size, sector_count)); done.count_down(); };
+      executor->submit(task, task);
+    }
+
+    readSectors(0, range_size);
+    done.wait();
+  }
+
+  return static_cast<ReadResult>(result.load());
+}
+
+#endif // BLIZZARD_ARCHIVE_NATIVE_MPQ
@@ -0,0 +1,234 @@
+#include <PathIndex.hpp>
+#include <Listfile.hpp>
+#include <algorithm>
+#include <cstring>
+
+using namespace BlizzardArchive::Listfile;
+
+namespace
+{
+  // Same normalization as the listfile contents: lowercase and forward slashes.
+  std::string normalizeQuery(std::string_view query)
+  {
+    std::string normalized(query);
+
+    for (char& c : normalized)
+    {
+      if (c >= 'A' && c <= 'Z')
+        c += 'a' - 'A';
+      else if (c == '\\')
+        c = '/';
+    }
+
+    return normalized;
+  }
+
+  // Extension of the file name, without the dot. Empty if there is none.
+  std::string_view extensionOf(std::string_view path)
+  {
+    std::size_t const dot = path.rfind('.');
+    std::size_t const slash = path.rfind('/');
+
+    if (dot == std::string_view::npos || (slash != std::string_view::npos && dot < slash))
+      return {};
+
+    return path.substr(dot + 1);
+  }
+
+  bool globMatch(std::string_view pattern, std::string_view path)
+  {
+    std::size_t p = 0;
+    std::size_t s = 0;
+
+    while (p < pattern.size())
+    {
+      if (pattern[p] == '*')
+      {
+        bool const deep = p + 1 < pattern.size() && pattern[p + 1] == '*';
+        std::size_t const next = p + (deep ? 2 : 1);
+
+        // "**/" also matches no directory at all.
+        if (deep && next < pattern.size() && pattern[next] == '/' && globMatch(pattern.substr(next + 1), path.substr(s)))
+          return true;
+
+        for (std::size_t i = s;; ++i)
+        {
+          if (globMatch(pattern.substr(next), path.substr(i)))
+            return true;
+
+          if (i == path.size() || (!deep && path[i] == '/'))
+            return false;
+        }
+      }
+
+      if (s == path.size())
+        return false;
+
+      if (pattern[p] == '?' ? path[s] == '/' : pattern[p] != path[s])
+        return false;
+
+      ++p;
+      ++s;
+    }
+
+    return s == path.size();
+  }
+}
+
+PathIndex::PathIndex(Listfile const& listfile)
+{
+  // Compact listfiles decode paths to a temporary buffer, so everything is copied first.
+  std::string buffer;
+  std::vector<std::pair<std::size_t, std::size_t>> spans;
+  std::vector<std::uint32_t> file_data_ids;
+
+  listfile.forEachEntry([&](std::string_view path, std::uint32_t file_data_id)
+  {
+    spans.emplace_back(buffer.size(), path.size());
+    file_data_ids.push_back(file_data_id);
+    buffer.append(path);
+  });
+
+  _blob = std::make_unique<char[]>(buffer.size());
+  std::memcpy(_blob.get(), buffer.data(), buffer.size());
+
+  _entries.reserve(spans.size());
+  for (std::size_t i = 0; i < spans.size(); ++i)
+  {
+    _entries.push_back({ std::string_view(_blob.get() + spans[i].first, spans[i].second), file_data_ids[i] });
+  }
+
+  // A path both in the listfile and in an archive listfile keeps its file data ID.
+  std::sort(_entries.begin(), _entries.end(), [](Entry const& lhs, Entry const& rhs)
+  {
+    return lhs.path != rhs.path ? lhs.path < rhs.path : lhs.file_data_id > rhs.file_data_id;
+  });
+
+  _entries.erase(std::unique(_entries.begin(), _entries.end()
+    , [](Entry const& lhs, Entry const& rhs) { return lhs.path == rhs.path; }), _entries.end());
+  _entries.shrink_to_fit();
+
+  _entries_by_extension = _entries;
+  std::stable_sort(_entries_by_extension.begin(), _entries_by_extension.end(), [](Entry const& lhs, Entry const& rhs)
+  {
+    return extensionOf(lhs.path) < extensionOf(rhs.path);
+  });
+
+  for (std::size_t begin = 0; begin < _entries_by_extension.size();)
+  {
+    std::string_view const extension = extensionOf(_entries_by_extension[begin].path);
+
+    std::size_t end = begin + 1;
+    while (end < _entries_by_extension.size() && extensionOf(_entries_by_extension[end].path) == extension)
+      ++end;
+
+    _extension_ranges.emplace(extension, std::make_pair(begin, end));
+    begin = end;
+  }
+}
+
+std::span<PathIndex::Entry const> PathIndex::prefixRange(std::string_view normalized_prefix) const
+{
+  auto begin = std::lower_bound(_entries.begin(), _entries.end(), normalized_prefix
+    , [](Entry const& entry, std::string_view value) { return entry.path < value; });
+
+  // Paths sharing a prefix are contiguous once sorted.
+  auto end = std::partition_point(begin, _entries.end()
+    , [&](Entry const& entry) { return entry.path.starts_with(normalized_prefix); });
+
+  return { begin, end };
+}
+
+std::span<PathIndex::Entry const> PathIndex::withPrefix(std::string_view prefix) const
+{
+  return prefixRange(normalizeQuery(prefix));
+}
+
+PathIndex::DirectoryListing PathIndex::listDirectory(std::string_view directory) const
+{
+  std::string prefix = normalizeQuery(directory);
+  while (!prefix.empty() && prefix.back() == '/')
+    prefix.pop_back();
+
+  if (!prefix.empty())
+    prefix.push_back('/');
+
+  std::span<Entry const> const range = prefixRange(prefix);
+  DirectoryListing listing;
+
+  for (auto it = range.begin(); it != range.end();)
+  {
+    std::size_t const slash = it->path.find('/', prefix.size());
+
+    if (slash == std::string_view::npos)
+    {
+      listing.files.push_back(*it);
+      ++it;
+      continue;
+    }
+
+    // Skip the whole subtree of the subdirectory.
+    std::string_view const subdirectory = it->path.substr(0, slash);
+    listing.subdirectories.push_back(subdirectory);
+
+    it = std::partition_point(it, range.end(), [&](Entry const& entry)
+    {
+      return entry.path.size() > slash && entry.path[slash] == '/' && entry.path.starts_with(subdirectory);
+    });
+  }
+
+  return listing;
+}
+
+std::span<PathIndex::Entry const> PathIndex::listDirectoryRecursive(std::string_view directory) const
+{
+  std::string prefix = normalizeQuery(directory);
+  while (!prefix.empty() && prefix.back() == '/')
+    prefix.pop_back();
+
+  if (!prefix.empty())
+    prefix.push_back('/');
+
+  return prefixRange(prefix);
+}
+
+std::span<PathIndex::Entry const> PathIndex::withExtension(std::string_view extension) const
+{
+  if (extension.starts_with('.'))
+    extension.remove_prefix(1);
+
+  auto it = _extension_ranges.find(std::string_view(normalizeQuery(extension)));
+
+  if (it == _extension_ranges.end())
+    return {};
+
+  return { _entries_by_extension.begin() + it->second.first, _entries_by_extension.begin() + it->second.second };
+}
+
+std::vector<PathIndex::Entry> PathIndex::glob(std::string_view pattern) const
+{
+  std::string const normalized = normalizeQuery(pattern);
+
+  std::size_t const wildcard = normalized.find_first_of("*?");
+  std::span<Entry const> candidates = prefixRange(std::string_view(normalized).substr(0, wildcard));
+
+  // A file name pattern of the form "*.ext" narrows the candidates to a single extension.
+  std::string_view const file_pattern = std::string_view(normalized).substr(normalized.rfind('/') + 1);
+  if (file_pattern.starts_with("*.") && file_pattern.find_first_of("*?.", 2) == std::string_view::npos)
+  {
+    std::span<Entry const> const by_extension = withExtension(file_pattern.substr(2));
+
+    if (by_extension.size() < candidates.size())
+      candidates = by_extension;
+  }
+
+  std::vector<Entry> matches;
+  for (auto const& entry : candidates)
+  {
+    if (globMatch(normalized, entry.path))
+      matches.push_back(entry);
+  }
+
+  // Extension ranges are sorted too, matches come out in path order either way.
+  return matches;
+}
@@ -0,0 +1,93 @@
+#include <PathPool.hpp>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+
+using namespace BlizzardArchive::Listfile;
+
+PathPool::PathPool()
+{
+  [[maybe_unused]] std::uint32_t empty = intern("");
+}
+
+PathPool::~PathPool()
+{
+  for (auto& chunk : _chunks)
+  {
+    delete[] chunk.load(std::memory_order_relaxed);
+  }
+}
+
+PathPool& PathPool::instance()
+{
+  static PathPool pool;
+  return pool;
+}
+
+std::uint32_t PathPool::intern(std::string_view path)
+{
+  {
+    const std::shared_lock _lock(_mutex);
+
+    auto it = _ids.find(path);
+    if (it != _ids.end())
+      return it->second;
+  }
+
+  const std::unique_lock _lock(_mutex);
+
+  // Another thread may have added it in between.
+  auto it = _ids.find(path);
+  if (it != _ids.end())
+    return it->second;
+
+  std::uint32_t const id = _size.load(std::memory_order_relaxed);
+  std::uint32_t const chunk_index = id >> ChunkBits;
+
+  if (chunk_index >= MaxChunks)
+    throw std::runtime_error("Path pool is full.");
+
+  Entry* chunk = _chunks[chunk_index].load(std::memory_order_relaxed);
+  if (!chunk)
+  {
+    chunk = new Entry[ChunkSize];
+    _chunks[chunk_index].store(chunk, std::memory_order_release);
+  }
+
+  Entry& entry = chunk[id & (ChunkSize - 1)];
+  entry.path = path;
+  entry.hash = std::hash<std::string_view>{}(entry.path);
+
+  _ids.emplace(std::string_view(entry.path), id);
+  _size.store(id + 1, std::memory_order_release);
+
+  return id;
+}
+
+std::uint32_t PathPool::find(std::string_view path) const
+{
+  const std::shared_lock _lock(_mutex);
+
+  auto it = _ids.find(path);
+  return it != _ids.end() ? it->second : NotFound;
+}
+
+BlizzardArchive::Archive::MPQNameHash PathPool::mpqHash(std::uint32_t id) const
+{
+  Entry const& path_entry = entry(id);
+
+  if (!path_entry.mpq_hashed.load(std::memory_order_acquire))
+  {
+    Archive::MPQNameHash const name_hash = Archive::hashMPQName(path_entry.path);
+    path_entry.mpq_hash[0].store(name_hash.table_index, std::memory_order_relaxed);
+    path_entry.mpq_hash[1].store(name_hash.name_a, std::memory_order_relaxed);
+    path_entry.mpq_hash[2].store(name_hash.name_b, std::memory_order_relaxed);
+    path_entry.mpq_hashed.store(true, std::memory_order_release);
+
+    return name_hash;
+  }
+
+  return { path_entry.mpq_hash[0].load(std::memory_order_relaxed)
+    , path_entry.mpq_hash[1].load(std::memory_order_relaxed)
+    , path_entry.mpq_hash[2].load(std::memory_order_relaxed) };
+}
@@ -0,0 +1,101 @@
+#include <SharedBuffer.hpp>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace BlizzardArchive;
+
+namespace
+{
+  SharedBuffer readWholeFile(std::string const& path)
+  {
+    std::ifstream stream {path, std::ios_base::binary | std::ios_base::in};
+
+    if (!stream.is_open())
+      return {};
+
+    std::vector<char> buffer;
+    stream.seekg(0, std::ios::end);
+    buffer.resize(stream.tellg());
+    stream.seekg(0, std::ios::beg);
+    stream.read(buffer.data(), buffer.size());
+
+    if (stream.fail())
+      return {};
+
+    return SharedBuffer(std::move(buffer));
+  }
+}
+
+SharedBuffer SharedBuffer::mapFile(std::string const& path)
+{
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr
+    , OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+  if (file == INVALID_HANDLE_VALUE)
+    return {};
+
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size) || static_cast<ULONGLONG>(file_size.QuadPart) < MapThreshold)
+  {
+    CloseHandle(file);
+    return readWholeFile(path);
+  }
+
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+  // The view keeps the mapping and the file alive on its own.
+  if (mapping)
+    CloseHandle(mapping);
+  CloseHandle(file);
+
+  if (!view)
+    return readWholeFile(path);
+
+  std::shared_ptr<void const> owner(view, [](void const* address) { UnmapViewOfFile(address); });
+  SharedBuffer mapped(std::move(owner), static_cast<char const*>(view), static_cast<std::size_t>(file_size.QuadPart));
+  mapped._mapped = true;
+  return mapped;
+#else
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+  if (fd < 0)
+    return {};
+
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || static_cast<std::size_t>(file_stat.st_size) < MapThreshold)
+  {
+    close(fd);
+    return readWholeFile(path);
+  }
+
+  std::size_t const file_size = static_cast<std::size_t>(file_stat.st_size);
+  void* address = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+  // The mapping holds its own reference to the file.
+  close(fd);
+
+  if (address == MAP_FAILED)
+    return readWholeFile(path);
+
+  std::shared_ptr<void const> owner(address, [file_size](void const* mapped)
+  {
+    munmap(const_cast<void*>(mapped), file_size);
+  });
+
+  SharedBuffer mapped(std::move(owner), static_cast<char const*>(address), file_size);
+  mapped._mapped = true;
+  return mapped;
+#endif
+}
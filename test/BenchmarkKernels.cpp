@@ -0,0 +1,116 @@
+#include "SelfTests.hpp"
+#include "TestUtils.hpp"
+
+#include <ListfileKernels.hpp>
+
+#include <array>
+
+using namespace BlizzardArchive;
+using namespace BlizzardArchive::Listfile;
+
+namespace
+{
+  struct KernelResults
+  {
+    std::string normalized;
+    std::size_t newlines = 0;
+    std::vector<std::size_t> separators;
+  };
+
+  // Runs every kernel on data, with the instruction set currently forced.
+  KernelResults runKernels(std::string const& data)
+  {
+    KernelResults results;
+    results.newlines = Kernels::countByte(data.data(), data.size(), '\n');
+
+    results.normalized = data;
+    Kernels::normalizeText(results.normalized.data(), results.normalized.size());
+
+    char* const begin = results.normalized.data();
+    char* const end = begin + results.normalized.size();
+
+    for (char* current = begin; current < end; ++current)
+    {
+      current = Kernels::findEitherByte(current, end, ';', '\0');
+      results.separators.push_back(current - begin);
+    }
+
+    return results;
+  }
+
+  // Listfile-like text: mixed case paths with both slashes and line endings, and some bytes above 0x7F.
+  std::string makeText(std::size_t size, unsigned seed)
+  {
+    static constexpr std::string_view Alphabet = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_/\\;.\r\n\xC3\xA9";
+
+    std::mt19937 random(seed);
+    std::string text(size, '\0');
+
+    for (char& c : text)
+    {
+      c = Alphabet[random() % Alphabet.size()];
+    }
+
+    return text;
+  }
+}
+
+void Tests::benchmarkKernels()
+{
+  constexpr std::array<std::pair<Kernels::InstructionSet, char const*>, 4> InstructionSets =
+  { {
+    { Kernels::InstructionSet::SCALAR, "scalar" },
+    { Kernels::InstructionSet::SSE41, "SSE4.1" },
+    { Kernels::InstructionSet::AVX2, "AVX2" },
+    { Kernels::InstructionSet::AVX512BW, "AVX-512BW" }
+  } };
+
+  Kernels::InstructionSet const active = Kernels::activeInstructionSet();
+
+  // Sizes around every vector width exercise the tails, the offset misaligns the start.
+  std::vector<std::string> inputs;
+  for (std::size_t size : { 0, 1, 15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 129, 1000, 4099 })
+  {
+    inputs.push_back(makeText(size, static_cast<unsigned>(size)));
+    inputs.push_back(makeText(size + 1, static_cast<unsigned>(size) + 1000).substr(1));
+  }
+
+  std::string const large = makeText(64 * 1024 * 1024, 7);
+
+  Kernels::forceInstructionSet(Kernels::InstructionSet::SCALAR);
+  std::vector<KernelResults> expected;
+  for (auto const& input : inputs)
+  {
+    expected.push_back(runKernels(input));
+  }
+
+  KernelResults const expected_large = runKernels(large);
+
+  for (auto const& [instruction_set, name] : InstructionSets)
+  {
+    if (!Kernels::forceInstructionSet(instruction_set))
+    {
+      std::cout << "  " << name << ": not supported by this CPU" << std::endl;
+      continue;
+    }
+
+    for (std::size_t i = 0; i < inputs.size(); ++i)
+    {
+      KernelResults const results = runKernels(inputs[i]);
+
+      check(results.normalized == expected[i].normalized && results.newlines == expected[i].newlines
+        && results.separators == expected[i].separators
+        , std::string(name) + " kernels match scalar on " + std::to_string(inputs[i].size()) + " bytes");
+    }
+
+    KernelResults results;
+    double const seconds = measureSeconds([&] { results = runKernels(large); });
+
+    check(results.normalized == expected_large.normalized && results.newlines == expected_large.newlines
+      && results.separators == expected_large.separators, std::string(name) + " kernels match scalar on large input");
+
+    std::cout << "  " << name << ": " << (large.size() / seconds / (1024 * 1024)) << " MiB/s" << std::endl;
+  }
+
+  Kernels::forceInstructionSet(active);
+}
@@ -0,0 +1,66 @@
+#include "SelfTests.hpp"
+#include "TestUtils.hpp"
+
+#include <Listfile.hpp>
+
+#include <algorithm>
+#include <thread>
+
+using namespace BlizzardArchive;
+
+void Tests::benchmarkListfileParse()
+{
+  constexpr std::size_t LineCount = 1'000'000;
+
+  TemporaryDirectory directory;
+  std::filesystem::path const path = directory.path() / "listfile.csv";
+
+  // Mixed case and backslashes like real listfiles, with CRLF lines, repeated paths and repeated
+  // file data IDs so the first occurrence has to win whatever chunk it lands in.
+  std::string csv;
+  std::mt19937 random(42);
+
+  for (std::size_t i = 0; i < LineCount; ++i)
+  {
+    std::uint32_t const file_data_id = (i % 97 == 0) ? static_cast<std::uint32_t>(i / 2 + 1) : static_cast<std::uint32_t>(i + 1);
+    std::size_t const path_number = (i % 89 == 0) ? random() % (i + 1) : i;
+
+    csv += std::to_string(file_data_id) + ";World\\Maps\\Azeroth\\Azeroth_" + std::to_string(path_number) + ".ADT"
+      + ((i & 1) ? "\r\n" : "\n");
+  }
+
+  writeFile(path, csv);
+
+  unsigned const max_threads = std::max(1u, std::thread::hardware_concurrency());
+
+  Listfile::Listfile serial;
+  double const serial_seconds = measureSeconds([&] { serial.initFromCSV(path.string(), 1); });
+
+  std::cout << "  1 thread: " << (csv.size() / serial_seconds / (1024 * 1024)) << " MiB/s" << std::endl;
+
+  for (unsigned thread_count = 2; thread_count <= max_threads; thread_count *= 2)
+  {
+    Listfile::Listfile parallel;
+    double const seconds = measureSeconds([&] { parallel.initFromCSV(path.string(), thread_count); });
+
+    std::cout << "  " << thread_count << " threads: " << (csv.size() / seconds / (1024 * 1024)) << " MiB/s, "
+      << "speedup " << (serial_seconds / seconds) << "x" << std::endl;
+
+    bool same_paths = parallel.pathToFileDataIDMap().size() == serial.pathToFileDataIDMap().size();
+    for (auto const& [file_path, file_data_id] : serial.pathToFileDataIDMap())
+    {
+      auto it = parallel.pathToFileDataIDMap().find(file_path);
+      same_paths = same_paths && it != parallel.pathToFileDataIDMap().end() && it->second == file_data_id;
+    }
+
+    bool same_ids = parallel.fileDataIDToPathMap().size() == serial.fileDataIDToPathMap().size();
+    for (auto const& [file_data_id, file_path] : serial.fileDataIDToPathMap())
+    {
+      auto it = parallel.fileDataIDToPathMap().find(file_data_id);
+      same_ids = same_ids && it != parallel.fileDataIDToPathMap().end() && it->second == file_path;
+    }
+
+    check(same_paths, std::to_string(thread_count) + " threads map the same paths as the serial parse");
+    check(same_ids, std::to_string(thread_count) + " threads map the same file data IDs as the serial parse");
+  }
+}
@@ -0,0 +1,74 @@
+#include "SelfTests.hpp"
+#include "TestUtils.hpp"
+
+#include <ClientData.hpp>
+
+#include <algorithm>
+#include <thread>
+
+using namespace BlizzardArchive;
+
+void Tests::benchmarkConcurrentReads()
+{
+  constexpr std::size_t FileCount = 2000;
+  constexpr std::size_t FileSize = 32 * 1024;
+
+  TemporaryDirectory client;
+  TemporaryDirectory project;
+  createClientLayout(client.path());
+
+  std::vector<MPQTestFile> files;
+  std::vector<Listfile::FileKey> file_keys;
+
+  for (std::size_t i = 0; i < FileCount; ++i)
+  {
+    std::string const name = "bench\\file_" + std::to_string(i) + ".bin";
+    files.push_back({ name, makeContents(FileSize, static_cast<unsigned>(i)) });
+    file_keys.emplace_back(name);
+  }
+
+  check(createMPQ(client.path() / "Data" / "common.MPQ", files), "archive is created");
+
+  ClientData client_data(client.path().string(), ClientVersion::WOTLK, Locale::enUS, project.path().string());
+
+  unsigned const max_threads = std::max(1u, std::thread::hardware_concurrency());
+  double single_thread_seconds = 0.0;
+
+  for (unsigned thread_count = 1; thread_count <= max_threads; thread_count *= 2)
+  {
+    std::atomic<std::size_t> next = 0;
+    std::atomic<std::size_t> mismatches = 0;
+
+    double const seconds = measureSeconds([&]
+    {
+      std::vector<std::thread> threads;
+      for (unsigned t = 0; t < thread_count; ++t)
+      {
+        threads.emplace_back([&]
+        {
+          std::vector<char> buffer;
+
+          for (std::size_t i = next++; i < FileCount; i = next++)
+          {
+            if (!client_data.readFile(file_keys[i], buffer)
+              || !std::equal(buffer.begin(), buffer.end(), files[i].contents.begin(), files[i].contents.end()))
+              ++mismatches;
+          }
+        });
+      }
+
+      for (auto& thread : threads)
+      {
+        thread.join();
+      }
+    });
+
+    if (thread_count == 1)
+      single_thread_seconds = seconds;
+
+    check(!mismatches, std::to_string(thread_count) + " threads read every file correctly");
+
+    std::cout << "  " << thread_count << " threads: " << (FileCount * FileSize / seconds / (1024 * 1024)) << " MiB/s, "
+      << "speedup " << (single_thread_seconds / seconds) << "x" << std::endl;
+  }
+}
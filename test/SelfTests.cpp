@@ -0,0 +1,51 @@
+#include "SelfTests.hpp"
+#include "TestUtils.hpp"
+
+#include <exception>
+#include <iostream>
+
+using namespace BlizzardArchive;
+
+namespace
+{
+  template<typename Test>
+  void run(char const* name, Test&& test)
+  {
+    std::cout << name << std::endl;
+
+    try
+    {
+      test();
+    }
+    catch (std::exception const& e)
+    {
+      Tests::check(false, std::string("unexpected exception: ") + e.what());
+    }
+  }
+}
+
+int Tests::runSelfTests()
+{
+  run("MPQ overrides", testMPQOverrides);
+  run("Directory refresh", testDirectoryRefresh);
+  run("Cached loose file", testCachedLooseFile);
+  run("Manifest extraction", testManifestExtraction);
+  run("Compact listfile", testCompactListfile);
+  run("Binary listfile", testBinaryListfile);
+  run("Path index", testPathIndex);
+  run("Native MPQ reader", testNativeMPQReader);
+  run("Remote CASC prefetch", testRemotePrefetch);
+
+  std::cout << (Failures ? "Self tests failed: " + std::to_string(Failures) + " checks" : "Self tests passed") << std::endl;
+  return Failures;
+}
+
+int Tests::runBenchmarks()
+{
+  run("Concurrent reads", benchmarkConcurrentReads);
+  run("Listfile kernels", benchmarkKernels);
+  run("Listfile parse", benchmarkListfileParse);
+
+  std::cout << (Failures ? "Benchmarks failed: " + std::to_string(Failures) + " checks" : "Benchmarks passed") << std::endl;
+  return Failures;
+}
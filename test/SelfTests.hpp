@@ -0,0 +1,33 @@
+#ifndef BLIZZARDARCHIVE_TEST_SELFTESTS_HPP
+#define BLIZZARDARCHIVE_TEST_SELFTESTS_HPP
+
+namespace BlizzardArchive::Tests
+{
+  /*
+  * Tests running on archives and listfiles generated in a temporary directory, so they need no
+  * game client. Returns the number of failed checks.
+  */
+  int runSelfTests();
+
+  /*
+  * Throughput of the parallel code paths on generated data, each checking its results against
+  * the sequential path too. Returns the number of failed checks.
+  */
+  int runBenchmarks();
+
+  void testMPQOverrides();
+  void testDirectoryRefresh();
+  void testCachedLooseFile();
+  void testManifestExtraction();
+  void testCompactListfile();
+  void testBinaryListfile();
+  void testPathIndex();
+  void testNativeMPQReader();
+  void testRemotePrefetch();
+
+  void benchmarkConcurrentReads();
+  void benchmarkKernels();
+  void benchmarkListfileParse();
+}
+
+#endif // BLIZZARDARCHIVE_TEST_SELFTESTS_HPP
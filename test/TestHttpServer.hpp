@@ -0,0 +1,259 @@
+#ifndef BLIZZARDARCHIVE_TEST_TESTHTTPSERVER_HPP
+#define BLIZZARDARCHIVE_TEST_TESTHTTPSERVER_HPP
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace BlizzardArchive::Tests
+{
+  /*
+  * Minimal HTTP/1.1 server on the loopback interface, standing in for a CDN. Serves GET requests
+  * (with single byte ranges) from memory, counts the requests per path and can make paths fail.
+  */
+  class HttpServer
+  {
+  public:
+#ifdef _WIN32
+    using Socket = SOCKET;
+    inline static constexpr Socket InvalidSocket = INVALID_SOCKET;
+#else
+    using Socket = int;
+    inline static constexpr Socket InvalidSocket = -1;
+#endif
+
+    HttpServer()
+    {
+#ifdef _WIN32
+      WSADATA wsa_data;
+      WSAStartup(MAKEWORD(2, 2), &wsa_data);
+#endif
+
+      _listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+      sockaddr_in address {};
+      address.sin_family = AF_INET;
+      address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      address.sin_port = 0;
+
+      socklen_t length = sizeof(address);
+
+      if (_listener == InvalidSocket
+        || bind(_listener, reinterpret_cast<sockaddr*>(&address), sizeof(address))
+        || listen(_listener, 64)
+        || getsockname(_listener, reinterpret_cast<sockaddr*>(&address), &length))
+        throw std::runtime_error("Could not start the test HTTP server.");
+
+      _port = ntohs(address.sin_port);
+      _acceptor = std::thread([this] { acceptLoop(); });
+    }
+
+    ~HttpServer()
+    {
+      // Wakes the acceptor up, then the connections, which the clients may keep open.
+      shutdown(_listener, 2);
+      closeSocket(_listener);
+      _acceptor.join();
+
+      {
+        const std::lock_guard _lock(_mutex);
+        _stopping = true;
+
+        for (Socket connection : _connections)
+        {
+          shutdown(connection, 2);
+        }
+      }
+
+      for (auto& thread : _threads)
+      {
+        thread.join();
+      }
+
+#ifdef _WIN32
+      WSACleanup();
+#endif
+    }
+
+    HttpServer(HttpServer const&) = delete;
+    HttpServer& operator=(HttpServer const&) = delete;
+
+    [[nodiscard]]
+    std::uint16_t port() const { return _port; }
+
+    // Host and port, as CDN host lists spell them.
+    [[nodiscard]]
+    std::string host() const { return "127.0.0.1:" + std::to_string(_port); }
+
+    void serve(std::string const& path, std::string contents)
+    {
+      const std::lock_guard _lock(_mutex);
+      _files[path] = std::move(contents);
+    }
+
+    // Answers 500 for the path from now on.
+    void fail(std::string const& path)
+    {
+      const std::lock_guard _lock(_mutex);
+      _failing.insert(path);
+    }
+
+    [[nodiscard]]
+    std::size_t requestCount(std::string const& path) const
+    {
+      const std::lock_guard _lock(_mutex);
+
+      auto it = _requests.find(path);
+      return it != _requests.end() ? it->second : 0;
+    }
+
+  private:
+    static void closeSocket(Socket socket)
+    {
+#ifdef _WIN32
+      closesocket(socket);
+#else
+      close(socket);
+#endif
+    }
+
+    void acceptLoop()
+    {
+      while (true)
+      {
+        Socket connection = accept(_listener, nullptr, nullptr);
+
+        if (connection == InvalidSocket)
+          return;
+
+        const std::lock_guard _lock(_mutex);
+
+        if (_stopping)
+        {
+          closeSocket(connection);
+          return;
+        }
+
+        _connections.insert(connection);
+        _threads.emplace_back([this, connection] { serveConnection(connection); });
+      }
+    }
+
+    // Answers requests on the connection until the client closes it.
+    void serveConnection(Socket connection)
+    {
+      std::string received;
+      char buffer[4096];
+
+      while (true)
+      {
+        std::size_t header_end;
+        while ((header_end = received.find("\r\n\r\n")) == std::string::npos)
+        {
+          int const count = recv(connection, buffer, sizeof(buffer), 0);
+
+          if (count <= 0)
+          {
+            const std::lock_guard _lock(_mutex);
+            _connections.erase(connection);
+            closeSocket(connection);
+            return;
+          }
+
+          received.append(buffer, count);
+        }
+
+        std::string const request = received.substr(0, header_end);
+        received.erase(0, header_end + 4);
+
+        std::string const response = respond(request);
+        send(connection, response.data(), static_cast<int>(response.size()), 0);
+      }
+    }
+
+    std::string respond(std::string const& request)
+    {
+      // "GET /path?query HTTP/1.1", then the headers.
+      std::size_t const path_begin = request.find(' ') + 1;
+      std::size_t const path_end = request.find_first_of(" ?", path_begin);
+      std::string const path = request.substr(path_begin, path_end - path_begin);
+
+      std::string body;
+      int status = 200;
+      {
+        const std::lock_guard _lock(_mutex);
+        ++_requests[path];
+
+        auto it = _files.find(path);
+
+        if (_failing.contains(path))
+          status = 500;
+        else if (it == _files.end())
+          status = 404;
+        else
+          body = it->second;
+      }
+
+      std::string extra_headers;
+      std::size_t const range = request.find("Range: bytes=");
+
+      if (status == 200 && range != std::string::npos)
+      {
+        unsigned long long first = 0;
+        unsigned long long last = 0;
+
+        if (std::sscanf(request.c_str() + range + 13, "%llu-%llu", &first, &last) == 2 && first <= last && first < body.size())
+        {
+          last = std::min<unsigned long long>(last, body.size() - 1);
+          extra_headers = "Content-Range: bytes " + std::to_string(first) + "-" + std::to_string(last) + "/" + std::to_string(body.size()) + "\r\n";
+          body = body.substr(first, last - first + 1);
+          status = 206;
+        }
+      }
+
+      std::string_view const reason = status == 200 ? "OK" : status == 206 ? "Partial Content" : status == 404 ? "Not Found" : "Internal Server Error";
+
+      return "HTTP/1.1 " + std::to_string(status) + " " + std::string(reason) + "\r\n"
+        + "Content-Length: " + std::to_string(body.size()) + "\r\n"
+        + extra_headers
+        + "Connection: keep-alive\r\n\r\n"
+        + body;
+    }
+
+    Socket _listener = InvalidSocket;
+    std::uint16_t _port = 0;
+    std::thread _acceptor;
+
+    std::unordered_map<std::string, std::string> _files;
+    std::unordered_set<std::string> _failing;
+    std::unordered_map<std::string, std::size_t> _requests;
+
+    std::unordered_set<Socket> _connections;
+    std::vector<std::thread> _threads;
+    bool _stopping = false;
+    mutable std::mutex _mutex;
+  };
+}
+
+#endif // BLIZZARDARCHIVE_TEST_TESTHTTPSERVER_HPP
@@ -0,0 +1,160 @@
+#include "SelfTests.hpp"
+#include "TestUtils.hpp"
+
+#include <Listfile.hpp>
+#include <ListfileRegistry.hpp>
+
+#include <cstring>
+#include <thread>
+
+using namespace BlizzardArchive;
+
+namespace
+{
+  std::string generatedPath(std::uint32_t file_data_id)
+  {
+    return "world/maps/azeroth/azeroth_" + std::to_string(file_data_id) + ".adt";
+  }
+
+  std::string readBytes(std::filesystem::path const& path)
+  {
+    std::ifstream stream(path, std::ios_base::binary | std::ios_base::in);
+    return std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+  }
+
+  bool rejectsBinary(std::filesystem::path const& path, std::string const& image)
+  {
+    Tests::writeFile(path, image);
+
+    try
+    {
+      Listfile::Listfile listfile;
+      listfile.initFromBinary(path.string());
+    }
+    catch (std::runtime_error const&)
+    {
+      return true;
+    }
+
+    return false;
+  }
+}
+
+void Tests::testBinaryListfile()
+{
+  constexpr std::uint32_t EntryCount = 5000;
+
+  TemporaryDirectory directory;
+  std::filesystem::path const csv_path = directory.path() / "listfile.csv";
+  std::filesystem::path const binary_path = directory.path() / "listfile.bin";
+
+  // Nested directories of different depths, plus a repeated path and a repeated file data ID where the
+  // first line has to win, as when parsing the CSV.
+  std::string csv;
+  for (std::uint32_t file_data_id = 1; file_data_id <= EntryCount; ++file_data_id)
+  {
+    csv += std::to_string(file_data_id) + ";";
+    csv += (file_data_id % 3 == 0) ? generatedPath(file_data_id)
+      : "interface/icons/" + std::string(file_data_id % 7, 'a') + "/icon_" + std::to_string(file_data_id) + ".blp";
+    csv += "\n";
+  }
+
+  csv += "9000000;" + generatedPath(3) + "\n";
+  csv += "3;world/maps/azeroth/duplicate.adt\n";
+  writeFile(csv_path, csv);
+
+  Listfile::Listfile source;
+  source.initFromCSV(csv_path.string());
+  source.writeBinary(binary_path.string());
+
+  check(!std::filesystem::exists(binary_path.string() + ".tmp"), "writing a binary listfile leaves no temporary file");
+
+  Listfile::Listfile binary;
+  binary.initFromBinary(binary_path.string());
+
+  bool paths_resolve = true;
+  for (auto const& [path, file_data_id] : source.pathToFileDataIDMap())
+    paths_resolve = paths_resolve && binary.getFileDataID(std::string(path)) == file_data_id;
+
+  bool ids_resolve = true;
+  for (auto const& [file_data_id, path] : source.fileDataIDToPathMap())
+    ids_resolve = ids_resolve && binary.getPath(file_data_id) == path;
+
+  std::size_t entry_count = 0;
+  binary.forEachEntry([&](std::string_view, std::uint32_t) { ++entry_count; });
+
+  check(paths_resolve, "every path resolves to its file data ID");
+  check(ids_resolve, "every file data ID resolves to its path");
+  check(entry_count == source.pathToFileDataIDMap().size(), "binary listfile visits every path");
+  check(binary.getFileDataID(generatedPath(3)) == 3 && binary.getPath(3) == generatedPath(3), "first occurrence wins");
+  check(!binary.getFileDataID("world/missing.adt") && binary.getPath(EntryCount + 1).empty(), "unknown entries are not found");
+
+  // Clients only map listfile.bin when asked to, the CSV keeps its maps otherwise.
+  auto const shared_csv = Listfile::ListfileRegistry::instance().acquire(directory.path().string());
+  auto const shared_binary = Listfile::ListfileRegistry::instance().acquire(directory.path().string(), true);
+  check(shared_csv->fileDataIDToPathMap().size() == source.fileDataIDToPathMap().size(), "registry loads the CSV by default");
+  check(shared_binary->fileDataIDToPathMap().empty() && shared_binary->getPath(1) == source.getPath(1), "registry maps listfile.bin when asked to");
+
+  std::string const image = readBytes(binary_path);
+  std::filesystem::path const corrupted_path = directory.path() / "corrupted.bin";
+
+  std::string bad_magic = image;
+  bad_magic[0] = 'X';
+  check(rejectsBinary(corrupted_path, bad_magic), "image with another magic is rejected");
+
+  // Header: magic, path_count, fdid_count, bucket_count, slot_count, reserved, seed, blob_size.
+  std::string no_buckets = image;
+  std::memset(no_buckets.data() + 12, 0, sizeof(std::uint32_t));
+  check(rejectsBinary(corrupted_path, no_buckets), "image without hash buckets is rejected");
+
+  std::string bad_blob = image;
+  ++bad_blob[32];
+  check(rejectsBinary(corrupted_path, bad_blob), "image with a mismatching blob size is rejected");
+
+  check(rejectsBinary(corrupted_path, image.substr(0, image.size() / 2)), "truncated image is rejected");
+  check(rejectsBinary(corrupted_path, image.substr(0, 16)), "image shorter than its header is rejected");
+}
+
+void Tests::testCompactListfile()
+{
+  constexpr std::uint32_t EntryCount = 2000;
+
+  TemporaryDirectory directory;
+  std::filesystem::path const path = directory.path() / "listfile.csv";
+
+  std::string csv;
+  for (std::uint32_t file_data_id = 1; file_data_id <= EntryCount; ++file_data_id)
+    csv += std::to_string(file_data_id) + ";" + generatedPath(file_data_id) + "\n";
+
+  writeFile(path, csv);
+
+  Listfile::Listfile listfile;
+  listfile.initFromCSV(path.string());
+  listfile.compact(16);
+
+  // Views of earlier lookups must survive later ones.
+  std::string_view const first = listfile.getPath(5);
+  std::string_view const second = listfile.getPath(1777);
+  check(first == generatedPath(5) && second == generatedPath(1777), "compacted listfile resolves paths");
+
+  std::atomic<bool> resolved = true;
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < 4; ++thread)
+  {
+    threads.emplace_back([&]
+    {
+      for (std::uint32_t file_data_id = 1; file_data_id <= EntryCount; ++file_data_id)
+      {
+        if (listfile.getPath(file_data_id) != generatedPath(file_data_id) || listfile.getFileDataID(generatedPath(file_data_id)) != file_data_id)
+          resolved = false;
+      }
+    });
+  }
+
+  for (std::thread& thread : threads)
+    thread.join();
+
+  check(resolved, "compacted listfile resolves every entry from several threads");
+  check(first == generatedPath(5) && second == generatedPath(1777), "paths stay valid after other lookups");
+  check(listfile.getPath(EntryCount + 1).empty() && !listfile.getFileDataID("world/missing.adt"), "unknown entries are not found");
+}
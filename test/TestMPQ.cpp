@@ -0,0 +1,107 @@
+#include "SelfTests.hpp"
+#include "TestUtils.hpp"
+
+#include <ClientData.hpp>
+
+using namespace BlizzardArchive;
+
+void Tests::testMPQOverrides()
+{
+  TemporaryDirectory client;
+  TemporaryDirectory project;
+  createClientLayout(client.path());
+
+  // Names on disk differ in case from the archive templates, as in clients copied from Windows.
+  createMPQ(client.path() / "Data" / "COMMON.mpq", {
+    { "test\\override.txt", "base" },
+    { "test\\base_only.txt", "base only" }
+  });
+
+  // The patch overrides a file without listing it, the index must not let the older listed copy win.
+  createMPQ(client.path() / "Data" / "Patch.MPQ", {
+    { "test\\override.txt", "patched" },
+    { "test\\unlisted.txt", "unlisted" }
+  }, false);
+
+  ClientData client_data(client.path().string(), ClientVersion::WOTLK, Locale::enUS, project.path().string());
+
+  std::vector<char> buffer;
+  check(client_data.readFile(Listfile::FileKey("test/override.txt"), buffer)
+    && std::string(buffer.begin(), buffer.end()) == "patched", "unlisted override wins over the listed original");
+
+  check(client_data.readFile(Listfile::FileKey("test/unlisted.txt"), buffer)
+    && std::string(buffer.begin(), buffer.end()) == "unlisted", "file missing from (listfile) is readable");
+
+  check(client_data.readFile(Listfile::FileKey("test/base_only.txt"), buffer)
+    && std::string(buffer.begin(), buffer.end()) == "base only", "file of the base archive is readable");
+
+  std::size_t const pool_size = Listfile::PathPool::instance().size();
+  check(!client_data.exists(Listfile::FileKey("test/missing.txt")), "missing file does not exist");
+  check(Listfile::PathPool::instance().size() == pool_size, "probing a missing name does not grow the path pool");
+
+  // MPQs are addressed by name only, a file data ID without a known path is not found.
+  check(!client_data.exists(Listfile::FileKey(123u)) && !client_data.readFile(Listfile::FileKey(123u), buffer)
+    , "file data ID without a path is not found");
+}
+
+void Tests::testDirectoryRefresh()
+{
+  TemporaryDirectory client;
+  TemporaryDirectory project;
+  createClientLayout(client.path());
+
+  createMPQ(client.path() / "Data" / "common.MPQ", { { "test\\override.txt", "archived" } });
+
+  // An extracted patch, loaded after common.MPQ as a directory archive.
+  std::filesystem::path const patch = client.path() / "Data" / "patch-5.MPQ";
+  writeFile(patch / "test" / "removed.txt", "removed");
+
+  ClientData client_data(client.path().string(), ClientVersion::WOTLK, Locale::enUS, project.path().string());
+  client_data.setCacheBudget(1024 * 1024);
+
+  std::vector<char> buffer;
+  check(client_data.readFile(Listfile::FileKey("test/override.txt"), buffer)
+    && std::string(buffer.begin(), buffer.end()) == "archived", "archived file is read before the loose one exists");
+  check(client_data.exists(Listfile::FileKey("test/removed.txt")), "loose file exists before removal");
+
+  writeFile(patch / "test" / "override.txt", "loose");
+  writeFile(patch / "test" / "added.txt", "added");
+  std::filesystem::remove(patch / "test" / "removed.txt");
+
+  // File systems with coarse timestamps may not see the change otherwise.
+  std::filesystem::last_write_time(patch / "test", std::filesystem::last_write_time(patch / "test") + std::chrono::seconds(2));
+
+  client_data.refreshDirectories();
+
+  check(client_data.readFile(Listfile::FileKey("test/override.txt"), buffer)
+    && std::string(buffer.begin(), buffer.end()) == "loose", "added loose file overrides the cached archived one");
+  check(client_data.readFile(Listfile::FileKey("test/added.txt"), buffer)
+    && std::string(buffer.begin(), buffer.end()) == "added", "added loose file is readable");
+  check(!client_data.exists(Listfile::FileKey("test/removed.txt")), "removed loose file no longer exists");
+}
+
+void Tests::testCachedLooseFile()
+{
+  TemporaryDirectory client;
+  TemporaryDirectory project;
+  createClientLayout(client.path());
+
+  createMPQ(client.path() / "Data" / "common.MPQ", { { "test\\archived.txt", "archived" } });
+
+  // Large enough to be mapped rather than read.
+  std::filesystem::path const loose = client.path() / "Data" / "patch-5.MPQ" / "test" / "large.bin";
+  std::string const contents = makeContents(4 * SharedBuffer::MapThreshold, 5);
+  writeFile(loose, contents);
+
+  ClientData client_data(client.path().string(), ClientVersion::WOTLK, Locale::enUS, project.path().string());
+  client_data.setCacheBudget(16 * 1024 * 1024);
+
+  SharedBuffer const first = client_data.readFileShared(Listfile::FileKey("test/large.bin"));
+  check(first && !first.isMapped(), "cached loose file is a copy, not a mapping");
+
+  // Truncated in place, as cp does, which faults readers of a mapping.
+  writeFile(loose, "short");
+
+  SharedBuffer const cached = client_data.readFileShared(Listfile::FileKey("test/large.bin"));
+  check(cached && std::string_view(cached.data(), cached.size()) == contents, "cache hit survives the loose file being rewritten in place");
+}
@@ -0,0 +1,102 @@
+#include "SelfTests.hpp"
+#include "TestUtils.hpp"
+
+#include <ClientData.hpp>
+#include <Manifest.hpp>
+
+#include <algorithm>
+#include <iterator>
+
+using namespace BlizzardArchive;
+
+namespace
+{
+  bool containsKey(std::vector<Listfile::FileKey> const& keys, std::string const& path)
+  {
+    return std::any_of(keys.begin(), keys.end(), [&](Listfile::FileKey const& key) { return key.filepath() == path; });
+  }
+
+  std::string readText(std::filesystem::path const& path)
+  {
+    std::ifstream stream(path, std::ios_base::binary | std::ios_base::in);
+    return std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+  }
+}
+
+void Tests::testManifestExtraction()
+{
+  TemporaryDirectory old_client;
+  TemporaryDirectory new_client;
+  TemporaryDirectory project;
+  createClientLayout(old_client.path());
+  createClientLayout(new_client.path());
+
+  createMPQ(old_client.path() / "Data" / "common.MPQ", {
+    { "test\\same.txt", "same" },
+    { "test\\changed.txt", "old contents" },
+    { "test\\removed.txt", "removed" }
+  });
+
+  createMPQ(new_client.path() / "Data" / "common.MPQ", {
+    { "test\\same.txt", "same" },
+    { "test\\changed.txt", "new contents" },
+    { "test\\added.txt", "added" }
+  });
+
+  Manifest old_manifest;
+  {
+    ClientData client_data(old_client.path().string(), ClientVersion::WOTLK, Locale::enUS, project.path().string());
+    old_manifest = client_data.exportManifest();
+  }
+
+  ClientData client_data(new_client.path().string(), ClientVersion::WOTLK, Locale::enUS, project.path().string());
+  Manifest const new_manifest = client_data.exportManifest();
+
+  check(old_manifest.entries().size() >= 3 && new_manifest.entries().size() >= 3, "manifests list the archived files");
+
+  // Save and load keep every entry as it was.
+  std::string const manifest_path = (project.path() / "manifest.bin").string();
+  old_manifest.save(manifest_path);
+
+  Manifest loaded;
+  loaded.load(manifest_path);
+
+  check(std::equal(loaded.entries().begin(), loaded.entries().end(), old_manifest.entries().begin(), old_manifest.entries().end()
+    , [](ManifestEntry const& lhs, ManifestEntry const& rhs)
+    {
+      return lhs.file_data_id == rhs.file_data_id && lhs.path == rhs.path && lhs.size == rhs.size
+        && lhs.hash_type == rhs.hash_type && lhs.hash == rhs.hash;
+    }), "manifest survives a save/load round trip");
+
+  check(!std::filesystem::exists(manifest_path + ".tmp"), "saving a manifest leaves no temporary file");
+
+  writeFile(project.path() / "broken.bin", "not a manifest");
+  bool rejected = false;
+  try
+  {
+    loaded.load((project.path() / "broken.bin").string());
+  }
+  catch (std::runtime_error const&)
+  {
+    rejected = true;
+  }
+  check(rejected, "loading a file that is not a manifest throws");
+
+  ManifestDiff const diff = loaded.diff(new_manifest);
+  check(containsKey(diff.added, "test/added.txt") && diff.added.size() == 1, "new file is added");
+  check(containsKey(diff.changed, "test/changed.txt") && !containsKey(diff.changed, "test/same.txt"), "only the rewritten file changed");
+  check(containsKey(diff.removed, "test/removed.txt") && diff.removed.size() == 1, "dropped file is removed");
+
+  // The project holds the old copy of the changed file, extraction replaces it.
+  writeFile(project.path() / "test" / "changed.txt", "old contents");
+
+  std::vector<Listfile::FileKey> to_extract = diff.added;
+  to_extract.insert(to_extract.end(), diff.changed.begin(), diff.changed.end());
+  to_extract.emplace_back("test/missing.txt");
+
+  check(client_data.extractFiles(to_extract, 2, 1) == to_extract.size() - 1, "every existing file is extracted");
+  check(readText(project.path() / "test" / "added.txt") == "added", "added file is extracted");
+  check(readText(project.path() / "test" / "changed.txt") == "new contents", "changed file replaces the old copy");
+  check(!std::filesystem::exists(project.path() / "test" / "missing.txt")
+    && !std::filesystem::exists(project.path() / "test" / "changed.txt.tmp"), "extraction leaves no stray files");
+}
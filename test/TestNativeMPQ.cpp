@@ -0,0 +1,103 @@
+#include "SelfTests.hpp"
+#include "TestUtils.hpp"
+
+#include <Listfile.hpp>
+#include <MPQArchive.hpp>
+
+#include <optional>
+
+using namespace BlizzardArchive;
+
+#ifdef BLIZZARD_ARCHIVE_NATIVE_MPQ
+namespace
+{
+  std::optional<std::vector<char>> readWithStormLib(HANDLE archive, std::string const& name)
+  {
+    HANDLE file = nullptr;
+    if (!SFileOpenFileEx(archive, name.c_str(), 0, &file))
+      return std::nullopt;
+
+    std::vector<char> buffer(SFileGetFileSize(file, nullptr));
+    bool const status = SFileReadFile(file, buffer.data(), static_cast<DWORD>(buffer.size()), nullptr, nullptr);
+    SFileCloseFile(file);
+
+    return status ? std::optional(std::move(buffer)) : std::nullopt;
+  }
+}
+#endif
+
+void Tests::testNativeMPQReader()
+{
+#ifdef BLIZZARD_ARCHIVE_NATIVE_MPQ
+  TemporaryDirectory directory;
+  std::filesystem::path const path = directory.path() / "native.MPQ";
+
+  std::string incompressible(70000, '\0');
+  std::mt19937 random(8);
+  for (char& c : incompressible)
+  {
+    c = static_cast<char>(random());
+  }
+
+  // Every layout the native reader handles, large files are split among the I/O workers.
+  std::vector<MPQTestFile> const files =
+  {
+    { "native\\stored.bin", makeContents(20000, 1), 0, 0 },
+    { "native\\stored_encrypted.bin", makeContents(20000, 2), MPQ_FILE_ENCRYPTED, 0 },
+    { "native\\zlib_small.txt", makeContents(3000, 3) },
+    { "native\\zlib_large.bin", makeContents(600000, 4) },
+    { "native\\encrypted.bin", makeContents(50000, 5), MPQ_FILE_COMPRESS | MPQ_FILE_ENCRYPTED },
+    { "native\\fix_key.bin", makeContents(300000, 6), MPQ_FILE_COMPRESS | MPQ_FILE_ENCRYPTED | MPQ_FILE_FIX_KEY },
+    { "native\\single_unit.bin", makeContents(40000, 7), MPQ_FILE_COMPRESS | MPQ_FILE_SINGLE_UNIT },
+    { "native\\single_unit_fix_key.bin", makeContents(40000, 8)
+      , MPQ_FILE_COMPRESS | MPQ_FILE_SINGLE_UNIT | MPQ_FILE_ENCRYPTED | MPQ_FILE_FIX_KEY },
+    { "native\\sector_crc.bin", makeContents(30000, 9), MPQ_FILE_COMPRESS | MPQ_FILE_SECTOR_CRC },
+    { "native\\incompressible.bin", incompressible },
+    { "native\\empty.txt", "" },
+    { "native\\bzip2.bin", makeContents(30000, 10), MPQ_FILE_COMPRESS, MPQ_COMPRESSION_BZIP2 }
+  };
+
+  check(createMPQ(path, files), "archive is created");
+
+  HANDLE storm_archive = nullptr;
+  if (!SFileOpenArchive(path.string().c_str(), 0, STREAM_FLAG_READ_ONLY, &storm_archive))
+  {
+    check(false, "archive opens in StormLib");
+    return;
+  }
+
+  Listfile::Listfile listfile;
+  Archive::MPQArchive archive(path.string(), Locale::enUS, &listfile);
+
+  std::vector<std::string> names;
+  check(archive.forEachFile([&](std::string const& name) { names.push_back(name); }), "archive is enumerable");
+  check(names.size() == files.size(), "every file is listed");
+
+  for (auto const& name : names)
+  {
+    std::optional<std::vector<char>> const expected = readWithStormLib(storm_archive, name);
+    if (!expected)
+    {
+      check(false, name + " is readable by StormLib");
+      continue;
+    }
+
+    Listfile::FileKey const file_key(name);
+    std::vector<char> buffer;
+
+    check(archive.readFile(file_key, Locale::enUS, buffer) && buffer == *expected, name + " reads the same bytes as StormLib");
+
+    // Only bzip2 needs StormLib, everything else must come out of the native path.
+    Archive::NativeMPQReader::ReadResult const result = archive.readFileNative(file_key, buffer);
+    bool const supported = name.find("bzip2") == std::string::npos;
+
+    check(result == (supported ? Archive::NativeMPQReader::ReadResult::OK : Archive::NativeMPQReader::ReadResult::UNSUPPORTED)
+      , name + " is " + (supported ? "read" : "left to StormLib") + " by the native reader");
+    check(result != Archive::NativeMPQReader::ReadResult::OK || buffer == *expected, name + " reads natively the same bytes as StormLib");
+  }
+
+  SFileCloseArchive(storm_archive);
+#else
+  std::cout << "  skipped, built without BLIZZARD_ARCHIVE_NATIVE_MPQ" << std::endl;
+#endif
+}
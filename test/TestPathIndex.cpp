@@ -0,0 +1,80 @@
+#include "SelfTests.hpp"
+#include "TestUtils.hpp"
+
+#include <Listfile.hpp>
+#include <PathIndex.hpp>
+
+using namespace BlizzardArchive;
+
+namespace
+{
+  template<typename Entries>
+  std::vector<std::uint32_t> fileDataIDs(Entries const& entries)
+  {
+    std::vector<std::uint32_t> file_data_ids;
+    for (Listfile::PathIndex::Entry const& entry : entries)
+      file_data_ids.push_back(entry.file_data_id);
+
+    return file_data_ids;
+  }
+
+  void checkIndex(Listfile::PathIndex const& index, std::string const& representation)
+  {
+    using IDs = std::vector<std::uint32_t>;
+
+    Tests::check(index.size() == 9, representation + ": index holds every path");
+
+    // Siblings sorting around the directory separator: "azeroth-x" and "azeroth.m2" before "azeroth/", "azeroth0" after.
+    Listfile::PathIndex::DirectoryListing const azeroth = index.listDirectory("World\\Maps\\Azeroth\\");
+    Tests::check(fileDataIDs(azeroth.files) == IDs{ 1, 2 }, representation + ": directory lists its own files");
+    Tests::check(azeroth.subdirectories == std::vector<std::string_view>{ "world/maps/azeroth/sub" }, representation + ": nested subtree is skipped as one subdirectory");
+
+    Listfile::PathIndex::DirectoryListing const maps = index.listDirectory("world/maps");
+    Tests::check(fileDataIDs(maps.files) == IDs{ 4 }, representation + ": file next to a directory of the same name is listed");
+    Tests::check(maps.subdirectories == std::vector<std::string_view>{ "world/maps/azeroth-x", "world/maps/azeroth", "world/maps/azeroth0" }
+      , representation + ": sibling directories sharing a prefix are listed once each");
+
+    Listfile::PathIndex::DirectoryListing const root = index.listDirectory("");
+    Tests::check(root.files.empty() && root.subdirectories == std::vector<std::string_view>{ "creature", "world" }, representation + ": root lists top level directories");
+
+    Tests::check(fileDataIDs(index.listDirectoryRecursive("world/maps/azeroth")) == IDs{ 1, 2, 3, 9 }, representation + ": recursive listing stays in the directory");
+    Tests::check(index.withPrefix("world/maps/azeroth").size() == 7, representation + ": prefix includes siblings");
+
+    Tests::check(fileDataIDs(index.withExtension(".M2")) == IDs{ 7, 4, 9, 6 }, representation + ": extension range with a dot and mixed case");
+    Tests::check(fileDataIDs(index.withExtension("adt")) == IDs{ 5, 1, 3 }, representation + ": extension range without a dot");
+    Tests::check(index.withExtension("blp").empty(), representation + ": unknown extension is empty");
+
+    Tests::check(fileDataIDs(index.glob("world/maps/*/*.adt")) == IDs{ 5, 1 }, representation + ": '*' does not cross directories");
+    Tests::check(fileDataIDs(index.glob("**/*.m2")) == IDs{ 7, 4, 9, 6 }, representation + ": leading \"**\" matches at any depth");
+    Tests::check(fileDataIDs(index.glob("world/**/c.adt")) == IDs{ 3 }, representation + ": \"**\" crosses directories");
+    Tests::check(fileDataIDs(index.glob("world/maps/azeroth/sub/**/c.adt")) == IDs{ 3 }, representation + ": \"**/\" matches no directory");
+    Tests::check(fileDataIDs(index.glob("world/maps/azeroth/**")) == IDs{ 1, 2, 3, 9 }, representation + ": trailing \"**\" matches the whole subtree");
+    Tests::check(fileDataIDs(index.glob("world/maps/azeroth?/*")) == IDs{ 6 }, representation + ": '?' matches one character");
+    Tests::check(fileDataIDs(index.glob("creature/bear/bear.???*")) == IDs{ 8 }, representation + ": '?' needs a character");
+    Tests::check(index.glob("*.m2").empty(), representation + ": '*' alone matches top level files only");
+  }
+}
+
+void Tests::testPathIndex()
+{
+  TemporaryDirectory directory;
+  std::filesystem::path const path = directory.path() / "listfile.csv";
+
+  writeFile(path,
+    "1;World/Maps/Azeroth/a.adt\n"
+    "2;World/Maps/Azeroth/b.wdt\n"
+    "3;World/Maps/Azeroth/sub/c.adt\n"
+    "4;World/Maps/Azeroth.m2\n"
+    "5;World/Maps/Azeroth-x/d.adt\n"
+    "6;World/Maps/Azeroth0/e.m2\n"
+    "7;Creature/Bear/bear.M2\n"
+    "8;creature/bear/bear.skin\n"
+    "9;world/maps/azeroth/sub/deeper/f.m2\n");
+
+  Listfile::Listfile listfile;
+  listfile.initFromCSV(path.string());
+  checkIndex(Listfile::PathIndex(listfile), "CSV");
+
+  listfile.compact(2);
+  checkIndex(Listfile::PathIndex(listfile), "compact");
+}
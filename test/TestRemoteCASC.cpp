@@ -0,0 +1,372 @@
+#include "SelfTests.hpp"
+#include "TestHttpServer.hpp"
+#include "TestUtils.hpp"
+
+#include <ClientData.hpp>
+
+#include <array>
+#include <cmath>
+#include <map>
+
+using namespace BlizzardArchive;
+
+namespace
+{
+  using Tests::HttpServer;
+
+  // RFC 1321, CASC names every blob and config by the MD5 of its contents.
+  ContentKey md5(std::string_view data)
+  {
+    static constexpr std::uint32_t Shifts[64] =
+    {
+      7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+      5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+      4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+      6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+    };
+
+    static std::array<std::uint32_t, 64> const Constants = []
+    {
+      std::array<std::uint32_t, 64> constants {};
+      for (std::size_t i = 0; i < constants.size(); ++i)
+      {
+        constants[i] = static_cast<std::uint32_t>(std::abs(std::sin(static_cast<double>(i + 1))) * 4294967296.0);
+      }
+      return constants;
+    }();
+
+    std::string message(data);
+    std::uint64_t const bit_length = std::uint64_t(data.size()) * 8;
+
+    message.push_back(static_cast<char>(0x80));
+    while (message.size() % 64 != 56)
+    {
+      message.push_back('\0');
+    }
+
+    for (int i = 0; i < 8; ++i)
+    {
+      message.push_back(static_cast<char>(bit_length >> (8 * i)));
+    }
+
+    std::uint32_t state[4] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476 };
+
+    for (std::size_t offset = 0; offset < message.size(); offset += 64)
+    {
+      std::uint32_t words[16];
+      for (int i = 0; i < 16; ++i)
+      {
+        auto const* bytes = reinterpret_cast<unsigned char const*>(message.data() + offset + i * 4);
+        words[i] = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (std::uint32_t(bytes[3]) << 24);
+      }
+
+      std::uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+
+      for (std::uint32_t i = 0; i < 64; ++i)
+      {
+        std::uint32_t f;
+        std::uint32_t g;
+
+        if (i < 16) { f = (b & c) | (~b & d); g = i; }
+        else if (i < 32) { f = (d & b) | (~d & c); g = (5 * i + 1) % 16; }
+        else if (i < 48) { f = b ^ c ^ d; g = (3 * i + 5) % 16; }
+        else { f = c ^ (b | ~d); g = (7 * i) % 16; }
+
+        f += a + Constants[i] + words[g];
+        a = d;
+        d = c;
+        c = b;
+        b += (f << Shifts[i]) | (f >> (32 - Shifts[i]));
+      }
+
+      state[0] += a;
+      state[1] += b;
+      state[2] += c;
+      state[3] += d;
+    }
+
+    ContentKey key;
+    for (std::size_t i = 0; i < key.size(); ++i)
+    {
+      key[i] = static_cast<std::uint8_t>(state[i / 4] >> (8 * (i % 4)));
+    }
+
+    return key;
+  }
+
+  std::string toHex(ContentKey const& key)
+  {
+    static constexpr char Digits[] = "0123456789abcdef";
+
+    std::string hex;
+    for (std::uint8_t byte : key)
+    {
+      hex.push_back(Digits[byte >> 4]);
+      hex.push_back(Digits[byte & 0xF]);
+    }
+
+    return hex;
+  }
+
+  void appendBigEndian(std::string& output, std::uint64_t value, int byte_count)
+  {
+    for (int i = byte_count - 1; i >= 0; --i)
+    {
+      output.push_back(static_cast<char>(value >> (8 * i)));
+    }
+  }
+
+  void appendLittleEndian(std::string& output, std::uint32_t value)
+  {
+    for (int i = 0; i < 4; ++i)
+    {
+      output.push_back(static_cast<char>(value >> (8 * i)));
+    }
+  }
+
+  void appendKey(std::string& output, ContentKey const& key)
+  {
+    output.append(reinterpret_cast<char const*>(key.data()), key.size());
+  }
+
+  /*
+  * A CDN serving a single build of a product, with every blob as a loose file: versions and cdns,
+  * build and CDN configs, the encoding and root manifests (pre 8.2 root layout) and the data.
+  * Blobs are BLTE with a single uncompressed chunk.
+  */
+  class SyntheticCDN
+  {
+  public:
+    struct Blob
+    {
+      std::string content;
+      ContentKey content_key;
+      std::string encoded;
+      ContentKey encoding_key;
+    };
+
+    inline static constexpr std::uint32_t BuildNumber = 36000;
+
+    explicit SyntheticCDN(HttpServer& server) : _server(server) {}
+
+    // URL template of versions and cdns, for region, product and file name.
+    [[nodiscard]]
+    std::string url() const { return "http://" + _server.host() + "/%s/%s/%s"; }
+
+    Blob const& add(std::uint32_t file_data_id, std::string const& content)
+    {
+      Blob blob = makeBlob(content);
+      auto [it, inserted] = _blobs.emplace(blob.encoding_key, std::move(blob));
+
+      _root[file_data_id] = it->second.content_key;
+      return it->second;
+    }
+
+    [[nodiscard]]
+    std::string dataPath(Blob const& blob) const { return objectPath("data", blob.encoding_key); }
+
+    void publish()
+    {
+      Blob const root = makeBlob(buildRoot());
+      _blobs.emplace(root.encoding_key, root);
+
+      Blob const encoding = makeBlob(buildEncoding());
+
+      for (auto const& [key, blob] : _blobs)
+      {
+        _server.serve(dataPath(blob), blob.encoded);
+      }
+
+      _server.serve(dataPath(encoding), encoding.encoded);
+
+      std::string const build_config = "# Build Configuration\n\n"
+        "root = " + toHex(root.content_key) + "\n"
+        "encoding = " + toHex(encoding.content_key) + " " + toHex(encoding.encoding_key) + "\n"
+        "encoding-size = " + std::to_string(encoding.content.size()) + " " + std::to_string(encoding.encoded.size()) + "\n"
+        "build-name = WOW-" + std::to_string(BuildNumber) + "patch9.0.2_Retail\n"
+        "build-uid = wow\n"
+        "build-product = WoW\n";
+
+      std::string const cdn_config = "# CDN Configuration\n\narchives = \narchive-group = \n";
+
+      ContentKey const build_config_key = md5(build_config);
+      ContentKey const cdn_config_key = md5(cdn_config);
+
+      _server.serve(objectPath("config", build_config_key), build_config);
+      _server.serve(objectPath("config", cdn_config_key), cdn_config);
+
+      _server.serve("/us/wow/versions"
+        , "Region!STRING:0|BuildConfig!HEX:16|CDNConfig!HEX:16|KeyRing!HEX:16|BuildId!DEC:4|VersionsName!String:0|ProductConfig!HEX:16\n"
+          "## seqn = 1\n"
+          "us|" + toHex(build_config_key) + "|" + toHex(cdn_config_key) + "||" + std::to_string(BuildNumber)
+          + "|9.0.2." + std::to_string(BuildNumber) + "|\n");
+
+      _server.serve("/us/wow/cdns"
+        , "Name!STRING:0|Path!STRING:0|Hosts!STRING:0|Servers!STRING:0|ConfigPath!STRING:0\n"
+          "## seqn = 1\n"
+          "us|tpr/wow|" + _server.host() + "|http://" + _server.host() + "/?maxhosts=4|tpr/configs/data\n");
+    }
+
+  private:
+    static Blob makeBlob(std::string const& content)
+    {
+      // No chunk table, the encoding key is the MD5 of the whole BLTE blob then.
+      std::string encoded = "BLTE";
+      appendBigEndian(encoded, 0, 4);
+      encoded.push_back('N');
+      encoded += content;
+
+      return { content, md5(content), encoded, md5(encoded) };
+    }
+
+    static std::string objectPath(std::string_view type, ContentKey const& key)
+    {
+      std::string const hex = toHex(key);
+      return "/tpr/wow/" + std::string(type) + "/" + hex.substr(0, 2) + "/" + hex.substr(2, 2) + "/" + hex;
+    }
+
+    // One block for every locale: file data ID deltas, then content key and name hash per file.
+    std::string buildRoot() const
+    {
+      std::string root;
+      appendLittleEndian(root, static_cast<std::uint32_t>(_root.size()));
+      appendLittleEndian(root, 0);
+      appendLittleEndian(root, 0xFFFFFFFF);
+
+      std::uint32_t previous = 0;
+      bool first = true;
+
+      for (auto const& [file_data_id, content_key] : _root)
+      {
+        appendLittleEndian(root, first ? file_data_id : file_data_id - previous - 1);
+        previous = file_data_id;
+        first = false;
+      }
+
+      for (auto const& [file_data_id, content_key] : _root)
+      {
+        appendKey(root, content_key);
+        appendLittleEndian(root, file_data_id);
+        appendLittleEndian(root, 0x5EED0000);
+      }
+
+      return root;
+    }
+
+    // A single page of content key entries and one of encoding key specs, all blobs stored raw ("n").
+    std::string buildEncoding() const
+    {
+      constexpr std::size_t PageSize = 4096;
+
+      std::map<ContentKey, Blob const*> by_content_key;
+      for (auto const& [key, blob] : _blobs)
+      {
+        by_content_key.emplace(blob.content_key, &blob);
+      }
+
+      std::string content_page;
+      for (auto const& [content_key, blob] : by_content_key)
+      {
+        content_page.push_back(1);
+        appendBigEndian(content_page, blob->content.size(), 5);
+        appendKey(content_page, blob->content_key);
+        appendKey(content_page, blob->encoding_key);
+      }
+
+      std::string spec_page;
+      for (auto const& [encoding_key, blob] : _blobs)
+      {
+        appendKey(spec_page, encoding_key);
+        appendBigEndian(spec_page, 0, 4);
+        appendBigEndian(spec_page, blob.encoded.size(), 5);
+      }
+
+      content_page.resize(PageSize, '\0');
+      spec_page.resize(PageSize, '\0');
+
+      std::string const specs("n\0", 2);
+
+      std::string encoding = "EN";
+      encoding.push_back(1);
+      encoding.push_back(16);
+      encoding.push_back(16);
+      appendBigEndian(encoding, PageSize / 1024, 2);
+      appendBigEndian(encoding, PageSize / 1024, 2);
+      appendBigEndian(encoding, 1, 4);
+      appendBigEndian(encoding, 1, 4);
+      encoding.push_back(0);
+      appendBigEndian(encoding, specs.size(), 4);
+      encoding += specs;
+
+      appendKey(encoding, by_content_key.begin()->first);
+      appendKey(encoding, md5(content_page));
+      encoding += content_page;
+
+      appendKey(encoding, _blobs.begin()->first);
+      appendKey(encoding, md5(spec_page));
+      encoding += spec_page;
+
+      return encoding + "n";
+    }
+
+    HttpServer& _server;
+    std::map<ContentKey, Blob> _blobs;
+    std::map<std::uint32_t, ContentKey> _root;
+  };
+}
+
+void Tests::testRemotePrefetch()
+{
+  check(toHex(md5("abc")) == "900150983cd24fb0d6963f7d28e17f72", "MD5 of the stand-in CDN is correct");
+
+  HttpServer server;
+  SyntheticCDN cdn(server);
+
+  std::string const shared = makeContents(50000, 1);
+
+  cdn.add(100, makeContents(30000, 2));
+  cdn.add(101, makeContents(1000, 3));
+  SyntheticCDN::Blob const shared_blob = cdn.add(102, shared);
+  cdn.add(103, shared);
+  SyntheticCDN::Blob const failing_blob = cdn.add(104, makeContents(2000, 4));
+  cdn.publish();
+
+  // The blob of 104 is listed in the manifests, but its download fails.
+  server.fail(cdn.dataPath(failing_blob));
+
+  TemporaryDirectory cache;
+  TemporaryDirectory project;
+  writeFile(project.path() / "listfile.csv", "100;test/a.bin\n101;test/b.bin\n102;test/c.bin\n103;test/d.bin\n104;test/e.bin\n");
+
+  ClientData client_data(cdn.url(), cache.path().string(), ClientVersion::SHADOWLANDS, Locale::enUS, project.path().string());
+
+  // 105 is not in the root manifest, 102 and 103 share a blob, 100 is asked for twice.
+  std::vector<Listfile::FileKey> const file_keys =
+  {
+    Listfile::FileKey(100u), Listfile::FileKey(101u), Listfile::FileKey(102u), Listfile::FileKey(103u)
+    , Listfile::FileKey(104u), Listfile::FileKey(105u), Listfile::FileKey(100u)
+  };
+
+  std::vector<PrefetchProgress> reports;
+  PrefetchProgress const progress = client_data.prefetch(file_keys, [&](PrefetchProgress const& report) { reports.push_back(report); }, 4);
+
+  check(progress.total == 5, "every distinct blob and unresolved file is counted once");
+  check(progress.completed == 3, "downloadable blobs complete");
+  check(progress.failed == 2, "unknown file and failed download are reported");
+  check(progress.bytes == 30000 + 1000 + shared.size(), "downloaded bytes are counted once per blob");
+  check(server.requestCount(cdn.dataPath(shared_blob)) == 1, "blob shared by two files is downloaded once");
+
+  check(reports.size() == 4, "progress is reported after every blob");
+
+  for (std::size_t i = 0; i < reports.size(); ++i)
+  {
+    check(reports[i].completed + reports[i].failed == i + 2 && reports[i].total == progress.total, "progress advances by one blob per report");
+  }
+
+  check(!reports.empty() && reports.back().completed == progress.completed && reports.back().bytes == progress.bytes
+    , "last report matches the result");
+
+  std::vector<char> buffer;
+  check(client_data.readFile(Listfile::FileKey(103u), buffer) && std::string(buffer.begin(), buffer.end()) == shared
+    , "prefetched file reads back");
+}
@@ -0,0 +1,126 @@
+#ifndef BLIZZARDARCHIVE_TEST_TESTUTILS_HPP
+#define BLIZZARDARCHIVE_TEST_TESTUTILS_HPP
+
+#include <StormLib.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace BlizzardArchive::Tests
+{
+  // Failed checks of the whole run.
+  inline std::atomic<int> Failures = 0;
+
+  inline void check(bool condition, std::string_view what)
+  {
+    if (!condition)
+    {
+      ++Failures;
+      std::cout << "  FAILED: " << what << std::endl;
+    }
+  }
+
+  // Directory under the system temporary directory, removed with its contents on destruction.
+  class TemporaryDirectory
+  {
+  public:
+    TemporaryDirectory()
+    {
+      std::random_device random;
+      _path = std::filesystem::temp_directory_path() / ("blizzard_archive_test_" + std::to_string(random()));
+      std::filesystem::create_directories(_path);
+    }
+
+    ~TemporaryDirectory()
+    {
+      std::error_code ec;
+      std::filesystem::remove_all(_path, ec);
+    }
+
+    TemporaryDirectory(TemporaryDirectory const&) = delete;
+    TemporaryDirectory& operator=(TemporaryDirectory const&) = delete;
+
+    [[nodiscard]]
+    std::filesystem::path const& path() const { return _path; }
+
+  private:
+    std::filesystem::path _path;
+  };
+
+  inline void writeFile(std::filesystem::path const& path, std::string_view contents)
+  {
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream stream(path, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+    stream.write(contents.data(), contents.size());
+  }
+
+  struct MPQTestFile
+  {
+    std::string name;
+    std::string contents;
+    DWORD flags = MPQ_FILE_COMPRESS;
+    DWORD compression = MPQ_COMPRESSION_ZLIB;
+  };
+
+  // Writes an archive with StormLib. Without a (listfile) the names are only in the hash table.
+  inline bool createMPQ(std::filesystem::path const& path, std::vector<MPQTestFile> const& files, bool with_listfile = true)
+  {
+    std::filesystem::create_directories(path.parent_path());
+
+    HANDLE archive = nullptr;
+    DWORD const create_flags = MPQ_CREATE_ARCHIVE_V1 | MPQ_CREATE_ATTRIBUTES | (with_listfile ? MPQ_CREATE_LISTFILE : 0);
+
+    if (!SFileCreateArchive(path.string().c_str(), create_flags, static_cast<DWORD>(files.size() + 16), &archive))
+      return false;
+
+    bool status = true;
+    for (auto const& file : files)
+    {
+      HANDLE file_handle = nullptr;
+
+      status = status
+        && SFileCreateFile(archive, file.name.c_str(), 0, static_cast<DWORD>(file.contents.size()), 0, file.flags, &file_handle)
+        && SFileWriteFile(file_handle, file.contents.data(), static_cast<DWORD>(file.contents.size()), file.compression)
+        && SFileFinishFile(file_handle);
+    }
+
+    return SFileCloseArchive(archive) && status;
+  }
+
+  // Game directory layout of a WotLK client with the enUS locale and no archives yet.
+  inline void createClientLayout(std::filesystem::path const& root)
+  {
+    writeFile(root / "Data" / "enUS" / "realmlist.wtf", "set realmlist localhost\n");
+  }
+
+  // Contents that compress reasonably, like most client files, with some noise.
+  inline std::string makeContents(std::size_t size, unsigned seed)
+  {
+    std::mt19937 random(seed);
+    std::string contents(size, '\0');
+
+    for (std::size_t i = 0; i < size; ++i)
+    {
+      contents[i] = static_cast<char>((i % 64 < 48) ? 'a' + (i / 64) % 26 : random());
+    }
+
+    return contents;
+  }
+
+  template<typename Fn>
+  double measureSeconds(Fn&& fn)
+  {
+    auto const begin = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  }
+}
+
+#endif // BLIZZARDARCHIVE_TEST_TESTUTILS_HPP
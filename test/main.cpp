@@ -1,12 +1,25 @@
 #include <ClientData.hpp>
 #include <ClientFile.hpp>
+#include "SelfTests.hpp"
 
 #include <iostream>
+#include <string_view>
 
 using namespace BlizzardArchive;
 
 int main(int argc, char* argv[])
 {
+  // Tests on generated data, the ones below need a client installed at the given paths.
+  if (argc > 1 && std::string_view(argv[1]) == "--self-test")
+  {
+    return Tests::runSelfTests() ? 1 : 0;
+  }
+
+  if (argc > 1 && std::string_view(argv[1]) == "--benchmark")
+  {
+    return Tests::runBenchmarks() ? 1 : 0;
+  }
+
   auto proj_path = std::string("/home/skarn/Desktop/test_proj/");
 
   // MPQ storage tests
@@ -23,7 +36,7 @@ int main(int argc, char* argv[])
     //auto directory_path = std::string("D:\\World of Warcraft");
     auto directory_path = std::string("/media/skarn/Boot Camp/World of Warcraft/");
 
-    auto wow_fs = BlizzardArchive::ClientData(directory_path, ClientVersion::SL, Locale::enUS, proj_path);
+    auto wow_fs = BlizzardArchive::ClientData(directory_path, ClientVersion::SHADOWLANDS, Locale::enUS, proj_path);
 
     auto file = BlizzardArchive::ClientFile(Listfile::FileKey("sound/music/citymusic/darnassus/darnassus intro.mp3"), &wow_fs);
     file.save();
@@ -37,7 +50,7 @@ int main(int argc, char* argv[])
     //auto directory_path = std::string("D:\\World of Warcraft");
     auto directory_path = std::string("/home/skarn/Desktop/cdn_cache_test/");
 
-    auto wow_fs = BlizzardArchive::ClientData("http://%s.falloflordaeron.com:8000/%s/%s", directory_path, ClientVersion::SL, Locale::enUS, proj_path);
+    auto wow_fs = BlizzardArchive::ClientData("http://%s.falloflordaeron.com:8000/%s/%s", directory_path, ClientVersion::SHADOWLANDS, Locale::enUS, proj_path);
 
     auto file = BlizzardArchive::ClientFile(Listfile::FileKey("sound/music/citymusic/orgrimmar/orgrimmar01-moment.mp3"), &wow_fs);
     file.save();
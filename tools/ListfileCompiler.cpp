@@ -0,0 +1,40 @@
+#include <Listfile.hpp>
+
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+using namespace BlizzardArchive;
+
+/*
+* Compiles listfile.csv to the binary format ListfileRegistry maps instead of parsing the CSV when asked to.
+* Usage: ListfileCompiler <listfile.csv> [listfile.bin], the output defaults to listfile.bin next to the CSV.
+*/
+int main(int argc, char* argv[])
+{
+  if (argc != 2 && argc != 3)
+  {
+    std::cerr << "Usage: " << argv[0] << " <listfile.csv> [listfile.bin]" << std::endl;
+    return 2;
+  }
+
+  std::filesystem::path const csv_path = argv[1];
+  std::filesystem::path const binary_path = argc == 3 ? std::filesystem::path(argv[2]) : csv_path.parent_path() / "listfile.bin";
+
+  try
+  {
+    Listfile::Listfile listfile;
+    listfile.initFromCSV(csv_path.string());
+    listfile.writeBinary(binary_path.string());
+
+    std::cout << "Compiled " << listfile.fileDataIDToPathMap().size() << " entries to " << binary_path.string() << std::endl;
+  }
+  catch (std::exception const& e)
+  {
+    std::cerr << "Error compiling " << csv_path.string() << ": " << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}